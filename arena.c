@@ -1,91 +1,145 @@
-
 #include "arena.h"
 
 #include <stdio.h>
 
 /**
- * Allocates a single internal arena.
+ * Returns where the given chunk starts, in bytes from the start of the first.
+ * As each chunk is twice the size of the last, this is a sum of the sizes before it.
  */
-void _Arena_allocate_internal_arena(Arena *arena) {
+static inline size_t _Arena_chunk_offset(Arena *arena, int chunk) {
+
+    return arena->first_chunk_size * (((size_t) 1 << chunk) - 1);
 
-    int new_arena_index = arena->number_of_arenas;
-    arena->number_of_arenas++;
+}
 
-    // Allocate enough space for another arena.
-    arena->arenas = realloc(arena->arenas, sizeof(_Arena) * arena->number_of_arenas);
+/**
+ * Allocates the next chunk, twice the size of the last.
+ *
+ * Returns 0 on success or -1 if there is no room for another chunk.
+ */
+static int _Arena_allocate_chunk(Arena *arena) {
+
+    if (arena->number_of_chunks == ARENA_MAX_CHUNKS) {
+        return -1;
+    }
+
+    _ArenaChunk *chunk = arena->chunks + arena->number_of_chunks;
+    chunk->size = arena->first_chunk_size << arena->number_of_chunks;
+    chunk->start = aligned_alloc(ARENA_ALIGNMENT, chunk->size);
+    if (chunk->start == NULL) {
+        return -1;
+    }
 
-    // Initialize our new arena.
-    _Arena *new_arena = arena->arenas + new_arena_index;
-    new_arena->start = malloc(arena->arena_size);
-    new_arena->end = new_arena->start;
-    new_arena->allocations_left = arena->allocations_per_arena;
+    arena->number_of_chunks++;
+    return 0;
 
 }
 
 Arena *Arena_create(size_t allocation_size, int allocations_hint) {
 
     Arena *arena = malloc(sizeof(Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
 
     // Figure out our allocation sizes.
-    arena->allocation_size = allocation_size;
-    arena->arena_size = allocation_size * allocations_hint;
-    arena->allocations_per_arena = allocations_hint;
+    arena->allocation_size = (allocation_size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    arena->first_chunk_size = arena->allocation_size * (allocations_hint > 0 ? allocations_hint : 1);
 
     // Zero out our stats.
     arena->stats.number_of_allocations = 0;
-
-    // Allocate a single arena.
-    arena->number_of_arenas = 0;
-    arena->arenas = NULL;
-    _Arena_allocate_internal_arena(arena);
+    arena->stats.high_water_mark = 0;
+
+    // Allocate a single chunk.
+    arena->number_of_chunks = 0;
+    arena->current_chunk = 0;
+    arena->used_in_chunk = 0;
+    if (_Arena_allocate_chunk(arena) != 0) {
+        free(arena);
+        return NULL;
+    }
 
     return arena;
 
 }
 
-void *Arena_delete(Arena *arena) {
+void Arena_delete(Arena *arena) {
 
-    for (int i = 0; i < arena->number_of_arenas; i++) {
-        free(arena->arenas[i].start);
+    for (int i = 0; i < arena->number_of_chunks; i++) {
+        free(arena->chunks[i].start);
     }
 
-    free(arena->arenas);
     free(arena);
 
 }
 
 void *Arena_allocate(Arena *arena) {
 
-    int allocate_from_arena_index = arena->number_of_arenas - 1;
-    _Arena *allocate_from = arena->arenas + allocate_from_arena_index;
+    // Move on to the next chunk once this one is full, reusing it if we have been here before.
+    if (arena->used_in_chunk + arena->allocation_size > arena->chunks[arena->current_chunk].size) {
 
-    // Check if we need to create a new arena.
-    if (allocate_from->allocations_left == 0) {
+        if (arena->current_chunk + 1 == arena->number_of_chunks && _Arena_allocate_chunk(arena) != 0) {
+            return NULL;
+        }
 
-        _Arena_allocate_internal_arena(arena);
-
-        // Point to the new arena instead.
-        allocate_from_arena_index++;
-        allocate_from = arena->arenas + allocate_from_arena_index;
+        arena->current_chunk++;
+        arena->used_in_chunk = 0;
 
     }
 
-    void *allocation = allocate_from->end;
-
-    // Update the arena's pointers.
-    allocate_from->end += arena->allocation_size;
-    allocate_from->allocations_left--;
+    void *allocation = arena->chunks[arena->current_chunk].start + arena->used_in_chunk;
+    arena->used_in_chunk += arena->allocation_size;
 
     arena->stats.number_of_allocations++;
+    size_t in_use = Arena_bytes_in_use(arena);
+    if (in_use > arena->stats.high_water_mark) {
+        arena->stats.high_water_mark = in_use;
+    }
+
     return allocation;
 
 }
 
+ArenaMark Arena_mark(Arena *arena) {
+
+    return Arena_bytes_in_use(arena);
+
+}
+
+void Arena_reset_to(Arena *arena, ArenaMark mark) {
+
+    // The mark lies in the current chunk or, rarely, one of the few before it.
+    int chunk = arena->current_chunk;
+    while (chunk > 0 && _Arena_chunk_offset(arena, chunk) > mark) {
+        chunk--;
+    }
+
+    arena->current_chunk = chunk;
+    arena->used_in_chunk = mark - _Arena_chunk_offset(arena, chunk);
+
+}
+
+size_t Arena_bytes_reserved(Arena *arena) {
+
+    return _Arena_chunk_offset(arena, arena->number_of_chunks);
+
+}
+
+size_t Arena_bytes_in_use(Arena *arena) {
+
+    // The unused end of a chunk that could not fit another allocation counts as used.
+    return _Arena_chunk_offset(arena, arena->current_chunk) + arena->used_in_chunk;
+
+}
+
 void Arena_print(Arena *arena) {
 
-    printf("Number of allocations: %d, number of resizes: %d\n",
-        arena->stats.number_of_allocations,
-        arena->number_of_arenas
+    printf("Arena: %zu bytes reserved in %d chunks, %zu in use with a high-water mark of %zu, and %lld allocations.\n",
+        Arena_bytes_reserved(arena),
+        arena->number_of_chunks,
+        Arena_bytes_in_use(arena),
+        arena->stats.high_water_mark,
+        arena->stats.number_of_allocations
     );
 
-}
\ No newline at end of file
+}
@@ -1,70 +1,109 @@
 /**
  *
- * This file describes a non-freeing memory arena.
+ * This file describes a scoped memory arena.
  *
  * These arenas hold only one type of data within them.
  * An arena is initialized with the type of data it expects
  * to hold and a hint as to how many allocations may be
  * needed.
  *
- * When the number of allocations is met, the arena will
- * allocate another space of equal size to continue allocating
- * from.
+ * When the current chunk of memory is full, the arena will
+ * move on to another chunk twice the size of the last, so
+ * an arena reaches any size in a few steps.
  *
- * Memory is freed only from destroying the arena.
+ * Single allocations are never freed. Instead the arena can
+ * be marked and later reset to the mark, releasing everything
+ * allocated since in one step. Chunks are kept for reuse and
+ * only freed by destroying the arena.
+ *
+ * Every allocation starts on its own cache line.
+ *
+ * An arena must only be used by one thread at a time.
  *
  */
 
 
 #include <stdlib.h>
 
-typedef struct {
+// The alignment and size granularity of every allocation.
+#define ARENA_ALIGNMENT 64
 
-    // The start of this arena's memory.
-    void *start;
+// The most chunks an arena may grow to, each twice the size of the last.
+#define ARENA_MAX_CHUNKS 40
+
+// A position within an arena, in bytes from the start of its first chunk.
+typedef size_t ArenaMark;
+
+typedef struct {
 
-    // The current end of this arena's memory.
-    // This is where the next allocation will be placed.
-    void *end;
+    // The start of this chunk's memory.
+    char *start;
 
-    // How many more allocations fit in this arena.
-    int allocations_left;
+    // The size of this chunk in bytes.
+    size_t size;
 
-} _Arena;
+} _ArenaChunk;
 
 typedef struct {
 
-    // The size of individual allocations within the arena
+    // The size of individual allocations within the arena,
+    // rounded up to the alignment.
     size_t allocation_size;
 
-    // The size of each arena.
-    size_t arena_size;
+    // The size of the first chunk.
+    size_t first_chunk_size;
 
-    // How many allocations fit in each arena.
-    int allocations_per_arena;
+    // The chunks allocated so far, in order of size.
+    _ArenaChunk chunks[ARENA_MAX_CHUNKS];
+    int number_of_chunks;
 
-    // The number of arenas allocated.
-    int number_of_arenas;
-
-    // The array of actual memory arenas.
-    _Arena *arenas;
+    // Where the next allocation will be placed.
+    int current_chunk;
+    size_t used_in_chunk;
 
     struct {
 
-        int number_of_allocations;
+        long long number_of_allocations;
+
+        // The furthest the arena has reached, as a mark.
+        size_t high_water_mark;
 
     } stats;
 
 } Arena;
 
+/**
+ * Allocates and deallocates an arena.
+ *
+ * Returns NULL if the arena could not be allocated.
+ */
 Arena *Arena_create(size_t allocation_size, int allocations_hint);
-void *Arena_delete(Arena *arena);
+void Arena_delete(Arena *arena);
 
 /**
  * Allocates a single new object in this arena.
+ *
+ * Returns NULL if the arena could not grow.
  */
 void *Arena_allocate(Arena *arena);
 
+/**
+ * Returns the current position of the arena, to be reset to later.
+ */
+ArenaMark Arena_mark(Arena *arena);
+
+/**
+ * Releases every allocation made since the mark was taken.
+ * Marks taken after it are no longer valid.
+ */
+void Arena_reset_to(Arena *arena, ArenaMark mark);
+
+/**
+ * Returns the total size of the chunks held and the bytes up to the current position.
+ */
+size_t Arena_bytes_reserved(Arena *arena);
+size_t Arena_bytes_in_use(Arena *arena);
+
 /**
  * Prints the statistics of this arena.
  */
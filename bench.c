@@ -0,0 +1,1229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "mancala.h"
+#include "gametree.h"
+#include "mancala_search.h"
+#include "mancala_batch.h"
+
+/**
+ * A fixed benchmark suite, printed as JSON so that runs can be compared.
+ *
+ * Build and run it with `make bench`, which builds it optimized with ARENA, with
+ * POOL and with neither. Every case reports its node counts, nodes per second, the
+ * calls made to the allocator and the peak resident memory while it ran.
+ *
+ * Exits with 1 if any case disagrees with another that must give the same result.
+ */
+
+// The memory given to the transposition table of each search case.
+#define BENCH_TABLE_SIZE (16 * 1024 * 1024)
+
+// The deepest perft depth any case may ask for.
+#define BENCH_MAX_PERFT_DEPTH 32
+
+// The most plays in a game played against itself.
+#define BENCH_MAX_GAME_PLAYS 512
+
+// How many plies short of a position's depth it is searched without pruning.
+#define BENCH_MINIMAX_PLIES_SHORT 4
+
+// The threads of a parallel search checked against a single thread, and the depth
+// from which they split the children of a node.
+#define BENCH_THREADS 4
+#define BENCH_THREADS_SPLIT_DEPTH 2
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+
+    // The Makefile links the benchmark with --wrap for each of these, so that every
+    // call from the program itself comes through here first.
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t number, size_t size);
+    void *__real_realloc(void *pointer, size_t size);
+
+    static long long bench_allocations = 0;
+
+    void *__wrap_malloc(size_t size) {
+        __atomic_fetch_add(&bench_allocations, 1, __ATOMIC_RELAXED);
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t number, size_t size) {
+        __atomic_fetch_add(&bench_allocations, 1, __ATOMIC_RELAXED);
+        return __real_calloc(number, size);
+    }
+
+    void *__wrap_realloc(void *pointer, size_t size) {
+        __atomic_fetch_add(&bench_allocations, 1, __ATOMIC_RELAXED);
+        return __real_realloc(pointer, size);
+    }
+
+    static inline long long _bench_allocations() {
+        return __atomic_load_n(&bench_allocations, __ATOMIC_RELAXED);
+    }
+
+#else
+
+    // Without the wrappers allocations are not counted.
+    static inline long long _bench_allocations() {
+        return -1;
+    }
+
+#endif
+
+/**
+ * A starting position for perft.
+ */
+typedef struct {
+
+    const char *name;
+    int length;
+    int starting_seeds;
+    int depth;
+
+} BenchPerftCase;
+
+/**
+ * A stored mid-game position to search to a fixed depth.
+ */
+typedef struct {
+
+    const char *name;
+    int length;
+    int turn;
+    int stores[2];
+    int lanes[2][GAMEBOARD_MAX_LENGTH];
+    int depth;
+
+} BenchPosition;
+
+/**
+ * A starting position for a game played against itself, searching every move to a fixed depth.
+ */
+typedef struct {
+
+    const char *name;
+    int length;
+    int starting_seeds;
+    int depth;
+
+} BenchGameCase;
+
+static BenchPerftCase bench_perft_cases[] = {
+    { "6x3", 6, 3, 9 },
+    { "6x4", 6, 4, 8 },
+    { "7x3", 7, 3, 8 },
+    { "4x4", 4, 4, 12 },
+};
+
+static BenchPosition bench_positions[] = {
+    { "6x3-ply6", 6, 0, { 7, 2 }, { { 5, 4, 1, 5, 0, 1 }, { 1, 5, 0, 0, 5, 0 } }, 14 },
+    { "6x4-ply8", 6, 0, { 2, 1 }, { { 1, 2, 7, 0, 7, 1 }, { 6, 1, 0, 8, 6, 6 } }, 12 },
+    { "6x4-ply16", 6, 1, { 7, 13 }, { { 8, 0, 1, 4, 0, 1 }, { 9, 1, 2, 0, 0, 2 } }, 14 },
+    { "4x4-ply6", 4, 0, { 3, 3 }, { { 1, 3, 4, 9 }, { 7, 0, 1, 1 } }, 16 },
+    { "6x6-ply10", 6, 1, { 5, 2 }, { { 3, 3, 2, 12, 0, 0 }, { 10, 1, 10, 10, 2, 12 } }, 11 },
+};
+
+static BenchGameCase bench_game_cases[] = {
+    { "6x4", 6, 4, 12 },
+    { "6x6", 6, 6, 10 },
+};
+
+#define BENCH_NUMBER_OF(cases) ((int) (sizeof(cases) / sizeof((cases)[0])))
+
+// Set once any case disagrees with another.
+static int bench_failed = 0;
+
+static inline long long _bench_now_ns() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+
+}
+
+/**
+ * Starts a case from a clean slate, resetting the peak resident memory where the
+ * system allows it.
+ */
+static void _bench_begin_case() {
+
+    #ifdef ARENA
+        arena_setup();
+    #endif
+
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs != NULL) {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+
+}
+
+static void _bench_end_case() {
+
+    #ifdef ARENA
+        arena_teardown();
+    #endif
+
+}
+
+/**
+ * Returns the peak resident memory in kilobytes since the current case began, or
+ * since the process started if it could not be reset.
+ */
+static long _bench_peak_rss_kb() {
+
+    long peak = -1;
+
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != NULL) {
+
+        char line[256];
+        while (fgets(line, sizeof(line), status)) {
+            if (sscanf(line, "VmHWM: %ld kB", &peak) == 1) {
+                break;
+            }
+        }
+        fclose(status);
+
+    }
+
+    if (peak < 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        peak = usage.ru_maxrss;
+    }
+
+    return peak;
+
+}
+
+/**
+ * Counts the positions at each ply below board using GameBoard_get_successors.
+ * Finished games are counted but not played on.
+ */
+static void _bench_perft_successors(GameBoard *board, int depth, int ply, long long *counts) {
+
+    counts[ply]++;
+    if (ply == depth || GameBoard_is_game_over(board)) {
+        return;
+    }
+
+    #ifdef ARENA
+        // Release the whole subtree from the arena once it is counted.
+        size_t arena_mark_before_successors = arena_mark();
+    #endif
+
+    GameBoard **successors;
+    int number_successors = GameBoard_get_successors(board, &successors);
+    for (int i = 0; i < number_successors; i++) {
+        _bench_perft_successors(successors[i], depth, ply + 1, counts);
+        GameBoard_delete(successors[i]);
+    }
+    free(successors);
+
+    #ifdef ARENA
+        arena_reset_to(arena_mark_before_successors);
+    #endif
+
+}
+
+/**
+ * Counts the positions at each ply below board using GameBoard_play_turn on copies.
+ */
+static void _bench_perft_play(GameBoard *board, int depth, int ply, long long *counts) {
+
+    counts[ply]++;
+    if (ply == depth || GameBoard_is_game_over(board)) {
+        return;
+    }
+
+    for (int i = 0; i < board->length; i++) {
+
+        if (!GameBoard_is_valid_play(board, i)) {
+            continue;
+        }
+
+        GameBoard successor = *board;
+        GameBoard_play_turn(&successor, i);
+        _bench_perft_play(&successor, depth, ply + 1, counts);
+
+    }
+
+}
+
+static void _bench_print_counts(long long *counts, int depth) {
+
+    printf("\"counts\": [");
+    for (int ply = 0; ply <= depth; ply++) {
+        printf("%s%lld", ply > 0 ? ", " : "", counts[ply]);
+    }
+    printf("]");
+
+}
+
+/**
+ * Runs every perft case with both ways of playing, checking that they agree.
+ */
+static void _bench_run_perft(int *is_first) {
+
+    const char *methods[] = { "successors", "play_turn" };
+
+    for (int c = 0; c < BENCH_NUMBER_OF(bench_perft_cases); c++) {
+
+        BenchPerftCase *perft = bench_perft_cases + c;
+        long long method_counts[2][BENCH_MAX_PERFT_DEPTH + 1];
+
+        for (int method = 0; method < 2; method++) {
+
+            long long *counts = method_counts[method];
+            memset(counts, 0, sizeof(method_counts[method]));
+
+            _bench_begin_case();
+            long long allocations = _bench_allocations();
+            long long start_ns = _bench_now_ns();
+
+            GameBoard *board = GameBoard_create(perft->length, perft->starting_seeds);
+            if (method == 0) {
+                _bench_perft_successors(board, perft->depth, 0, counts);
+            } else {
+                _bench_perft_play(board, perft->depth, 0, counts);
+            }
+            GameBoard_delete(board);
+
+            long long elapsed_ns = _bench_now_ns() - start_ns;
+            allocations = _bench_allocations() < 0 ? -1 : _bench_allocations() - allocations;
+            long peak_rss_kb = _bench_peak_rss_kb();
+            _bench_end_case();
+
+            long long nodes = 0;
+            for (int ply = 0; ply <= perft->depth; ply++) {
+                nodes += counts[ply];
+            }
+
+            int matches = memcmp(method_counts[0], counts, (perft->depth + 1) * sizeof(long long)) == 0;
+            bench_failed |= !matches;
+
+            printf("%s\n    {\"name\": \"%s\", \"method\": \"%s\", \"length\": %d, \"starting_seeds\": %d, \"depth\": %d, ",
+                *is_first ? "" : ",", perft->name, methods[method], perft->length, perft->starting_seeds, perft->depth);
+            _bench_print_counts(counts, perft->depth);
+            printf(", \"nodes\": %lld, \"time_ms\": %.3f, \"nodes_per_second\": %.0f, \"allocations\": %lld, \"peak_rss_kb\": %ld, \"matches\": %s}",
+                nodes, elapsed_ns / 1e6, nodes * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1), allocations, peak_rss_kb, matches ? "true" : "false");
+            *is_first = 0;
+
+        }
+
+    }
+
+}
+
+/**
+ * Sets up a search the way minmax_player does, on a single thread so that every run
+ * explores exactly the same nodes, or as a plain alpha beta search over nodes.
+ *
+ * A specialized search calls the board directly, otherwise every game function is
+ * called through its pointer.
+ */
+static void _bench_setup_search(MinMaxSearch *search, int depth, int in_place, int specialized, TranspositionTable *table) {
+
+    memset(search, 0, sizeof(MinMaxSearch));
+
+    search->options.max_depth = depth;
+    search->options.time_limit_in_ms = -1;
+    search->options.dead_state_pruning = 1;
+    search->options.alpha_beta_pruning = 1;
+    search->options.order_static = 1;
+    search->options.threads = 1;
+
+    search->utility = (int (*) (void *, int)) &GameBoard_utility;
+    search->is_terminal = (int (*) (void *)) &GameBoard_is_game_over;
+    search->get_turn = (int (*) (void *)) &GameBoard_current_turn;
+    search->get_successors = (int (*) (void *, void ***)) &GameBoard_get_successors;
+    search->free_state = (void (*) (void *)) &GameBoard_delete;
+    search->is_dead_state = (int (*) (void *, int)) &GameBoard_is_dead_state;
+    search->get_move_made = (int (*) (void *)) &GameBoard_move_made;
+    search->move_hint = (int (*) (void *, int)) &GameBoard_move_hint;
+
+    if (!in_place) {
+        return;
+    }
+
+    search->options.iterative_deepening = 1;
+    search->options.starting_depth = 1;
+    search->options.depth_step = 1;
+    search->options.aspiration_window = 2;
+    search->options.order_killers = 1;
+    search->options.order_history = 1;
+
+    search->get_moves = (int (*) (void *, int *)) &GameBoard_get_moves;
+    search->make_move = (void (*) (void *, int, void *)) &GameBoard_make_move;
+    search->unmake_move = (void (*) (void *, void *)) &GameBoard_unmake_move;
+    search->undo_size = sizeof(GameBoardUndo);
+
+    search->hash = (uint64_t (*) (void *)) &GameBoard_hash;
+    search->transposition_table = table;
+
+    if (specialized) {
+        GameBoard_setup_search(search);
+    }
+
+}
+
+static GameBoard *_bench_create_position(BenchPosition *position) {
+
+    GameBoard *board = GameBoard_create(position->length, 0);
+    board->turn = position->turn;
+    for (int player = 0; player < 2; player++) {
+
+        board->stores[player] = position->stores[player];
+        for (int i = 0; i < position->length; i++) {
+            board->lanes[player][i] = position->lanes[player][i];
+        }
+
+    }
+    GameBoard_update_totals(board);
+
+    return board;
+
+}
+
+/**
+ * Searches every stored position to its depth in place the way minmax_player does,
+ * through function pointers and specialized for the board, and two plies shallower
+ * with a plain alpha beta search over nodes.
+ *
+ * Both in place searches must find the same move and utility over the same nodes.
+ */
+static void _bench_run_search(int *is_first) {
+
+    const char *methods[] = { "nodes", "in_place", "specialized" };
+
+    TranspositionTable *table = TranspositionTable_create(BENCH_TABLE_SIZE);
+
+    for (int p = 0; p < BENCH_NUMBER_OF(bench_positions); p++) {
+
+        BenchPosition *position = bench_positions + p;
+        int moves[3];
+        int utilities[3];
+        long long nodes_explored[3];
+
+        for (int method = 0; method < 3; method++) {
+
+            // Plain alpha beta over nodes allocates every node, so it stops short.
+            int depth = method == 0 ? position->depth - 2 : position->depth;
+
+            TranspositionTable_clear(table);
+
+            _bench_begin_case();
+            long long allocations = _bench_allocations();
+            long long start_ns = _bench_now_ns();
+
+            MinMaxSearch search;
+            _bench_setup_search(&search, depth, method >= 1, method == 2, table);
+            MinMaxSearch_reset_stats(&search);
+
+            Node root;
+            root.game_state = _bench_create_position(position);
+            root.number_successors = -1;
+
+            Node *to_play = MinMaxSearch_search(&search, &root);
+            moves[method] = ((GameBoard *) to_play->game_state)->play_made.pit_played;
+            utilities[method] = search.best_utility;
+            nodes_explored[method] = search.stats.nodes_explored;
+
+            GameBoard_delete(root.game_state);
+            root.game_state = NULL;
+            Node_cleanup(&root, search.free_state);
+
+            long long elapsed_ns = _bench_now_ns() - start_ns;
+            allocations = _bench_allocations() < 0 ? -1 : _bench_allocations() - allocations;
+            long peak_rss_kb = _bench_peak_rss_kb();
+            _bench_end_case();
+
+            int matches = method < 2 || (moves[2] == moves[1] && utilities[2] == utilities[1] && nodes_explored[2] == nodes_explored[1]);
+            bench_failed |= !matches;
+
+            printf("%s\n    {\"name\": \"%s\", \"method\": \"%s\", \"depth\": %d, \"best_move\": %d, \"utility\": %d, ",
+                *is_first ? "" : ",", position->name, methods[method], depth, moves[method], search.best_utility);
+            printf("\"nodes_generated\": %lld, \"nodes_explored\": %lld, \"time_ms\": %.3f, \"nodes_per_second\": %.0f, \"allocations\": %lld, \"peak_rss_kb\": %ld, \"matches\": %s, \"stats\": ",
+                search.stats.nodes_generated, search.stats.nodes_explored, elapsed_ns / 1e6,
+                search.stats.nodes_explored * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1), allocations, peak_rss_kb, matches ? "true" : "false");
+            MinMaxSearch_write_stats(&search, stdout, MINMAXSEARCH_STATS_JSON);
+            printf("}");
+            *is_first = 0;
+
+        }
+
+    }
+
+    TranspositionTable_delete(table);
+
+}
+
+/**
+ * Searches every stored position with each algorithm, first against a search without
+ * pruning a few plies shallower and then at the position's depth, in place and
+ * specialized for the board the way minmax_player does.
+ *
+ * Every algorithm must find the same move and utility as the search without pruning,
+ * and then as alpha beta.
+ */
+static void _bench_run_algorithms(int *is_first) {
+
+    const char *algorithms[] = { "minimax", "alpha_beta", "pvs", "mtdf" };
+    const int options[] = { MINMAXSEARCH_ALPHA_BETA, MINMAXSEARCH_ALPHA_BETA, MINMAXSEARCH_PVS, MINMAXSEARCH_MTDF };
+
+    TranspositionTable *table = TranspositionTable_create(BENCH_TABLE_SIZE);
+
+    for (int p = 0; p < BENCH_NUMBER_OF(bench_positions); p++) {
+
+        BenchPosition *position = bench_positions + p;
+
+        // Without pruning every node is searched, so it stops well short.
+        for (int is_full_depth = 0; is_full_depth < 2; is_full_depth++) {
+
+            int depth = is_full_depth ? position->depth : position->depth - BENCH_MINIMAX_PLIES_SHORT;
+            int moves[4];
+            int utilities[4];
+
+            for (int algorithm = is_full_depth; algorithm < 4; algorithm++) {
+
+                TranspositionTable_clear(table);
+
+                MinMaxSearch search;
+                _bench_setup_search(&search, depth, 1, 1, table);
+                search.options.algorithm = options[algorithm];
+                if (algorithm == 0) {
+                    search.options.iterative_deepening = 0;
+                    search.options.alpha_beta_pruning = 0;
+                    search.transposition_table = NULL;
+                }
+                MinMaxSearch_reset_stats(&search);
+
+                Node root;
+                root.game_state = _bench_create_position(position);
+                root.number_successors = -1;
+
+                long long start_ns = _bench_now_ns();
+                Node *to_play = MinMaxSearch_search(&search, &root);
+                long long elapsed_ns = _bench_now_ns() - start_ns;
+
+                moves[algorithm] = ((GameBoard *) to_play->game_state)->play_made.pit_played;
+                utilities[algorithm] = search.best_utility;
+
+                GameBoard_delete(root.game_state);
+                root.game_state = NULL;
+                Node_cleanup(&root, search.free_state);
+
+                // Compared with the search without pruning, or with alpha beta at full depth.
+                int reference = is_full_depth;
+                int matches = algorithm == reference || (moves[algorithm] == moves[reference] && utilities[algorithm] == utilities[reference]);
+                bench_failed |= !matches;
+
+                printf("%s\n    {\"name\": \"%s\", \"algorithm\": \"%s\", \"depth\": %d, \"best_move\": %d, \"utility\": %d, ",
+                    *is_first ? "" : ",", position->name, algorithms[algorithm], depth, moves[algorithm], search.best_utility);
+                printf("\"nodes_explored\": %lld, \"time_ms\": %.3f, \"nodes_per_second\": %.0f, \"matches\": %s, \"stats\": ",
+                    search.stats.nodes_explored, elapsed_ns / 1e6,
+                    search.stats.nodes_explored * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1), matches ? "true" : "false");
+                MinMaxSearch_write_stats(&search, stdout, MINMAXSEARCH_STATS_JSON);
+                printf("}");
+                *is_first = 0;
+
+            }
+
+        }
+
+    }
+
+    TranspositionTable_delete(table);
+
+}
+
+/**
+ * Searches every stored position to its depth with each algorithm, with and without a
+ * transposition table, on a single thread and then split between BENCH_THREADS threads.
+ *
+ * At a fixed depth the threads must find the same move and utility as a single one.
+ */
+static void _bench_run_threads(int *is_first) {
+
+    const char *algorithms[] = { "alpha_beta", "pvs", "mtdf" };
+    const int options[] = { MINMAXSEARCH_ALPHA_BETA, MINMAXSEARCH_PVS, MINMAXSEARCH_MTDF };
+
+    TranspositionTable *table = TranspositionTable_create(BENCH_TABLE_SIZE);
+
+    for (int p = 0; p < BENCH_NUMBER_OF(bench_positions); p++) {
+
+        BenchPosition *position = bench_positions + p;
+        int depth = position->depth;
+
+        for (int algorithm = 0; algorithm < 3; algorithm++) {
+
+            for (int has_table = 0; has_table < 2; has_table++) {
+
+                int moves[2];
+                int utilities[2];
+
+                for (int is_parallel = 0; is_parallel < 2; is_parallel++) {
+
+                    TranspositionTable_clear(table);
+
+                    MinMaxSearch search;
+                    _bench_setup_search(&search, depth, 1, 1, has_table ? table : NULL);
+                    search.options.algorithm = options[algorithm];
+                    search.options.threads = is_parallel ? BENCH_THREADS : 1;
+                    search.options.split_depth = BENCH_THREADS_SPLIT_DEPTH;
+                    MinMaxSearch_reset_stats(&search);
+
+                    Node root;
+                    root.game_state = _bench_create_position(position);
+                    root.number_successors = -1;
+
+                    long long start_ns = _bench_now_ns();
+                    Node *to_play = MinMaxSearch_search(&search, &root);
+                    long long elapsed_ns = _bench_now_ns() - start_ns;
+
+                    moves[is_parallel] = ((GameBoard *) to_play->game_state)->play_made.pit_played;
+                    utilities[is_parallel] = search.best_utility;
+
+                    GameBoard_delete(root.game_state);
+                    root.game_state = NULL;
+                    Node_cleanup(&root, search.free_state);
+
+                    int matches = !is_parallel || (moves[1] == moves[0] && utilities[1] == utilities[0]);
+                    bench_failed |= !matches;
+
+                    printf("%s\n    {\"name\": \"%s\", \"algorithm\": \"%s\", \"table\": %s, \"threads\": %d, \"depth\": %d, \"best_move\": %d, \"utility\": %d, ",
+                        *is_first ? "" : ",", position->name, algorithms[algorithm], has_table ? "true" : "false",
+                        search.options.threads, depth, moves[is_parallel], search.best_utility);
+                    printf("\"nodes_explored\": %lld, \"time_ms\": %.3f, \"matches\": %s}",
+                        search.stats.nodes_explored, elapsed_ns / 1e6, matches ? "true" : "false");
+                    *is_first = 0;
+
+                }
+
+            }
+
+        }
+
+    }
+
+    TranspositionTable_delete(table);
+
+}
+
+/**
+ * Plays every game case against itself, searching each move afresh and then carrying
+ * the search over from one move to the next with MinMaxSearch_advance. Both are run
+ * in place the way minmax_player does, and two plies shallower over nodes, where
+ * the subtree below each play is kept.
+ *
+ * Carrying the search over must play the same game.
+ */
+static void _bench_run_games(int *is_first) {
+
+    const char *methods[] = { "in_place", "in_place_carried", "nodes", "nodes_carried" };
+
+    TranspositionTable *table = TranspositionTable_create(BENCH_TABLE_SIZE);
+
+    for (int g = 0; g < BENCH_NUMBER_OF(bench_game_cases); g++) {
+
+        BenchGameCase *game = bench_game_cases + g;
+        int plays[4][BENCH_MAX_GAME_PLAYS];
+        int number_plays[4];
+
+        for (int method = 0; method < 4; method++) {
+
+            int in_place = method < 2;
+            int is_carried = method % 2;
+            int depth = in_place ? game->depth : game->depth - 2;
+
+            TranspositionTable_clear(table);
+
+            _bench_begin_case();
+            long long allocations = _bench_allocations();
+            long long start_ns = _bench_now_ns();
+
+            MinMaxSearch search;
+            _bench_setup_search(&search, depth, in_place, in_place, table);
+
+            Node root;
+            root.game_state = GameBoard_create(game->length, game->starting_seeds);
+            root.number_successors = -1;
+            root.successors = NULL;
+
+            long long nodes_generated = 0;
+            long long nodes_explored = 0;
+            long long slowest_play_ns = 0;
+            number_plays[method] = 0;
+
+            while (!GameBoard_is_game_over(root.game_state) && number_plays[method] < BENCH_MAX_GAME_PLAYS) {
+
+                long long play_start_ns = _bench_now_ns();
+
+                MinMaxSearch_reset_stats(&search);
+                Node *to_play = MinMaxSearch_search(&search, &root);
+                int pit_to_play = ((GameBoard *) to_play->game_state)->play_made.pit_played;
+
+                // Searching afresh, the play is made on a board of its own.
+                if (!is_carried || !MinMaxSearch_advance(&search, &root, pit_to_play)) {
+                    GameBoard *next = GameBoard_copy(root.game_state);
+                    GameBoard_play_turn(next, pit_to_play);
+                    Node_cleanup(&root, search.free_state);
+                    root.game_state = next;
+                    root.number_successors = -1;
+                    root.successors = NULL;
+                }
+
+                long long play_ns = _bench_now_ns() - play_start_ns;
+                slowest_play_ns = play_ns > slowest_play_ns ? play_ns : slowest_play_ns;
+                nodes_generated += search.stats.nodes_generated;
+                nodes_explored += search.stats.nodes_explored;
+                plays[method][number_plays[method]++] = pit_to_play;
+
+            }
+
+            Node_cleanup(&root, search.free_state);
+
+            long long elapsed_ns = _bench_now_ns() - start_ns;
+            allocations = _bench_allocations() < 0 ? -1 : _bench_allocations() - allocations;
+            long peak_rss_kb = _bench_peak_rss_kb();
+            _bench_end_case();
+
+            int matches = !is_carried || (
+                number_plays[method] == number_plays[method - 1] &&
+                memcmp(plays[method], plays[method - 1], number_plays[method] * sizeof(int)) == 0
+            );
+            bench_failed |= !matches;
+
+            printf("%s\n    {\"name\": \"%s\", \"method\": \"%s\", \"depth\": %d, \"plays\": %d, ",
+                *is_first ? "" : ",", game->name, methods[method], depth, number_plays[method]);
+            printf("\"nodes_generated\": %lld, \"nodes_explored\": %lld, \"time_ms\": %.3f, \"slowest_play_ms\": %.3f, \"allocations\": %lld, \"peak_rss_kb\": %ld, \"matches\": %s}",
+                nodes_generated, nodes_explored, elapsed_ns / 1e6, slowest_play_ns / 1e6, allocations, peak_rss_kb, matches ? "true" : "false");
+            *is_first = 0;
+
+        }
+
+    }
+
+    TranspositionTable_delete(table);
+
+}
+
+/**
+ * Returns the next number from a xorshift64 sequence.
+ */
+static inline uint64_t _bench_random(uint64_t *state) {
+
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+
+}
+
+/**
+ * Plays a turn by sowing one seed at a time, as GameBoard_play_turn did before it
+ * sowed full laps at once. Kept to check the two against each other.
+ */
+static int _bench_reference_play_turn(GameBoard *board, int pit_to_play) {
+
+    board->play_made.pit_played = pit_to_play;
+    board->play_made.turn = board->turn;
+    board->play_made.was_capture = 0;
+    board->play_made.was_chain = 0;
+
+    int starting_turn = board->turn;
+
+    seed_t *playing_lane = board->lanes[starting_turn];
+    seed_t *playing_store = &(board->stores[starting_turn]);
+
+    int seeds_left = playing_lane[pit_to_play];
+    playing_lane[pit_to_play] = 0;
+    pit_to_play++;
+
+    int current_turn = starting_turn;
+    while (seeds_left > 0) {
+
+        if (pit_to_play < board->length) {
+
+            playing_lane[pit_to_play]++;
+            pit_to_play++;
+            seeds_left--;
+
+        } else {
+
+            if (current_turn == starting_turn) {
+                (*playing_store)++;
+                seeds_left--;
+            }
+
+            pit_to_play = 0;
+            current_turn = (current_turn + 1) % 2;
+            playing_lane = board->lanes[current_turn];
+
+        }
+
+    }
+
+    if (current_turn != starting_turn && pit_to_play == 0) {
+        board->play_made.was_chain = 1;
+    } else {
+        board->turn = (board->turn + 1) % 2;
+    }
+
+    if (current_turn == starting_turn && pit_to_play > 0) {
+
+        int landed_in_pit_index = pit_to_play - 1;
+        int landed_in_pit = playing_lane[landed_in_pit_index];
+        int opponents_turn = (starting_turn + 1) % 2;
+        int adjacent_pit_index = board->length - landed_in_pit_index - 1;
+        int adjacent_pit = board->lanes[opponents_turn][adjacent_pit_index];
+
+        if (adjacent_pit > 0 && landed_in_pit == 1) {
+
+            board->lanes[opponents_turn][adjacent_pit_index] = 0;
+            playing_lane[landed_in_pit_index] = 0;
+            (*playing_store) += adjacent_pit + 1;
+
+            board->play_made.was_capture = 1;
+
+        }
+
+    }
+
+    // Count the lanes from scratch, to check the totals every play keeps.
+    GameBoard_update_totals(board);
+
+    return board->turn;
+
+}
+
+/**
+ * Fills a board of the given length with up to max_seeds seeds in each pit.
+ */
+static void _bench_random_board(GameBoard *board, int length, int max_seeds, uint64_t *random_state) {
+
+    memset(board, 0, sizeof(GameBoard));
+    board->length = length;
+    board->turn = _bench_random(random_state) % 2;
+    board->play_made.pit_played = -1;
+    board->play_made.turn = -1;
+    board->play_made.was_capture = -1;
+    board->play_made.was_chain = -1;
+
+    for (int player = 0; player < 2; player++) {
+
+        board->stores[player] = _bench_random(random_state) % (max_seeds + 1);
+        for (int i = 0; i < length; i++) {
+            // Leave plenty of pits empty so captures come up often.
+            if (_bench_random(random_state) % 3 > 0) {
+                board->lanes[player][i] = _bench_random(random_state) % (max_seeds + 1);
+            }
+        }
+
+    }
+    GameBoard_update_totals(board);
+
+}
+
+/**
+ * Plays every valid pit of random boards of every length, with both few and many
+ * seeds, through GameBoard_play_turn and the seed-by-seed reference, and through
+ * GameBoard_make_move and back, checking that the boards match exactly.
+ */
+static void _bench_run_sowing_equivalence(int *is_first) {
+
+    int max_seeds[] = { 3, 12, 100, 2000 };
+    uint64_t random_state = 0x2545f4914f6cdd1dULL;
+
+    long long plays = 0;
+    long long mismatches = 0;
+
+    for (int length = 1; length <= GAMEBOARD_MAX_LENGTH; length++) {
+        for (int m = 0; m < BENCH_NUMBER_OF(max_seeds); m++) {
+            for (int n = 0; n < 2000; n++) {
+
+                GameBoard board;
+                _bench_random_board(&board, length, max_seeds[m], &random_state);
+
+                for (int pit = 0; pit < length; pit++) {
+
+                    if (!GameBoard_is_valid_play(&board, pit)) {
+                        continue;
+                    }
+
+                    GameBoard expected = board;
+                    _bench_reference_play_turn(&expected, pit);
+
+                    GameBoard played = board;
+                    GameBoard_play_turn(&played, pit);
+
+                    GameBoard unmade = board;
+                    GameBoardUndo undo;
+                    GameBoard_make_move(&unmade, pit, &undo);
+                    int made_matches = memcmp(&unmade, &expected, sizeof(GameBoard)) == 0;
+                    GameBoard_unmake_move(&unmade, &undo);
+
+                    plays++;
+                    if (memcmp(&played, &expected, sizeof(GameBoard)) != 0 || !made_matches
+                            || memcmp(&unmade, &board, sizeof(GameBoard)) != 0) {
+                        mismatches++;
+                    }
+
+                }
+
+            }
+        }
+    }
+
+    bench_failed |= mismatches > 0;
+
+    printf("%s\n    {\"name\": \"equivalence\", \"plays\": %lld, \"mismatches\": %lld}",
+        *is_first ? "" : ",", plays, mismatches);
+    *is_first = 0;
+
+}
+
+/**
+ * Times sowing from pits holding hundreds of seeds, seed by seed and by full laps.
+ */
+static void _bench_run_sowing_throughput(int *is_first) {
+
+    const char *methods[] = { "seed_by_seed", "full_laps" };
+
+    #define BENCH_SOWING_BOARDS 256
+    GameBoard boards[BENCH_SOWING_BOARDS];
+    uint64_t random_state = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < BENCH_SOWING_BOARDS; i++) {
+        _bench_random_board(boards + i, 6, 1000, &random_state);
+    }
+
+    for (int method = 0; method < 2; method++) {
+
+        long long plays = 0;
+        long long seeds = 0;
+        long long start_ns = _bench_now_ns();
+
+        for (int round = 0; round < 200; round++) {
+            for (int i = 0; i < BENCH_SOWING_BOARDS; i++) {
+                for (int pit = 0; pit < boards[i].length; pit++) {
+
+                    if (!GameBoard_is_valid_play(boards + i, pit)) {
+                        continue;
+                    }
+
+                    GameBoard board = boards[i];
+                    seeds += board.lanes[board.turn][pit];
+                    if (method == 0) {
+                        _bench_reference_play_turn(&board, pit);
+                    } else {
+                        GameBoard_play_turn(&board, pit);
+                    }
+                    plays++;
+
+                    // Keep the play from being optimized away.
+                    seeds += board.stores[0] & 1;
+
+                }
+            }
+        }
+
+        long long elapsed_ns = _bench_now_ns() - start_ns;
+
+        printf("%s\n    {\"name\": \"large_seeds\", \"method\": \"%s\", \"length\": 6, \"plays\": %lld, \"seeds_sown\": %lld, \"time_ms\": %.3f, \"plays_per_second\": %.0f}",
+            *is_first ? "" : ",", methods[method], plays, seeds, elapsed_ns / 1e6, plays * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1));
+        *is_first = 0;
+
+    }
+
+}
+
+/**
+ * Plays random games from every perft starting position, move by move through the
+ * board's functions and then by GameBoard_playout, from the same seed.
+ *
+ * Picking pits the way GameBoard_play_random documents, every play of the reference
+ * must be valid and both must end every game on the same board.
+ */
+static void _bench_run_playouts(int *is_first) {
+
+    const char *methods[] = { "move_by_move", "kernel" };
+
+    #define BENCH_PLAYOUTS 200000
+
+    for (int c = 0; c < BENCH_NUMBER_OF(bench_perft_cases); c++) {
+
+        BenchPerftCase *game = bench_perft_cases + c;
+        GameBoard *start = GameBoard_create(game->length, game->starting_seeds);
+
+        uint64_t checksums[2];
+        long long plies = 0;
+
+        for (int method = 0; method < 2; method++) {
+
+            uint64_t random_state = GameBoard_seed_random(c + 1);
+            uint64_t checksum = 0;
+            int is_valid = 1;
+
+            long long start_ns = _bench_now_ns();
+
+            for (int i = 0; i < BENCH_PLAYOUTS; i++) {
+
+                GameBoard board = *start;
+                int score_difference;
+
+                if (method == 0) {
+
+                    while (!GameBoard_is_game_over(&board)) {
+
+                        int moves[GAMEBOARD_MAX_LENGTH];
+                        int number_moves = GameBoard_get_moves(&board, moves);
+                        int pit_to_play = moves[((_bench_random(&random_state) >> 32) * number_moves) >> 32];
+
+                        is_valid &= GameBoard_is_valid_play(&board, pit_to_play);
+                        GameBoard_play_turn(&board, pit_to_play);
+                        plies++;
+
+                    }
+                    score_difference = GameBoard_score_of(&board, 0) - GameBoard_score_of(&board, 1);
+
+                } else {
+
+                    score_difference = GameBoard_playout(&board, &random_state);
+
+                }
+
+                checksum = checksum * 31 + (GameBoard_hash(&board) ^ (uint64_t) score_difference);
+
+            }
+
+            long long elapsed_ns = _bench_now_ns() - start_ns;
+
+            checksums[method] = checksum;
+            int matches = is_valid && (method == 0 || checksums[1] == checksums[0]);
+            bench_failed |= !matches;
+
+            printf("%s\n    {\"name\": \"%s\", \"method\": \"%s\", \"playouts\": %d, \"plies\": %lld, \"time_ms\": %.3f, \"playouts_per_second\": %.0f, \"plies_per_second\": %.0f, \"matches\": %s}",
+                *is_first ? "" : ",", game->name, methods[method], BENCH_PLAYOUTS, plies, elapsed_ns / 1e6,
+                BENCH_PLAYOUTS * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1), plies * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1), matches ? "true" : "false");
+            *is_first = 0;
+
+        }
+
+        GameBoard_delete(start);
+
+    }
+
+}
+
+/**
+ * Plays random boards of every length a batch at a time and one at a time with
+ * GameBoard_play_turn, some games sitting out each turn, on until every game is over.
+ *
+ * Every game of the batch must end each turn on the board played alone and agree
+ * on whether it is over.
+ */
+static void _bench_run_batch_equivalence(int *is_first) {
+
+    int max_seeds[] = { 3, 12, 100, 2000 };
+    uint64_t random_state = 0x5851f42d4c957f2dULL;
+
+    long long plays = 0;
+    long long mismatches = 0;
+
+    for (int length = 1; length <= GAMEBOARD_MAX_LENGTH; length++) {
+        for (int m = 0; m < BENCH_NUMBER_OF(max_seeds); m++) {
+            for (int n = 0; n < 50; n++) {
+
+                GameBoard boards[GAMEBOARD_BATCH_SIZE];
+                GameBoardBatch batch;
+                GameBoardBatch_setup(&batch, length);
+                for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+                    _bench_random_board(boards + game, length, max_seeds[m], &random_state);
+                    GameBoardBatch_set(&batch, game, boards + game);
+                }
+
+                int is_over = 0;
+                while (!is_over) {
+
+                    int pits[GAMEBOARD_BATCH_SIZE];
+                    is_over = 1;
+                    for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+
+                        pits[game] = -1;
+                        if (GameBoard_is_game_over(boards + game) || _bench_random(&random_state) % 8 == 0) {
+                            continue;
+                        }
+
+                        int moves[GAMEBOARD_MAX_LENGTH];
+                        int number_moves = GameBoard_get_moves(boards + game, moves);
+                        pits[game] = moves[_bench_random(&random_state) % number_moves];
+                        is_over = 0;
+
+                    }
+
+                    GameBoardBatch_play_turn(&batch, pits);
+                    uint32_t games_over = GameBoardBatch_is_game_over(&batch);
+
+                    for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+
+                        if (pits[game] >= 0) {
+                            GameBoard_play_turn(boards + game, pits[game]);
+                            plays++;
+                        }
+
+                        GameBoard played;
+                        GameBoardBatch_get(&batch, game, &played);
+                        int is_game_over = (games_over >> game) & 1;
+                        if (!GameBoard_is_same_position(&played, boards + game) || is_game_over != GameBoard_is_game_over(boards + game)) {
+                            mismatches++;
+                        }
+
+                    }
+
+                }
+
+            }
+        }
+    }
+
+    bench_failed |= mismatches > 0;
+
+    printf("%s\n    {\"name\": \"batch_equivalence\", \"batch_size\": %d, \"plays\": %lld, \"mismatches\": %lld}",
+        *is_first ? "" : ",", GAMEBOARD_BATCH_SIZE, plays, mismatches);
+    *is_first = 0;
+
+}
+
+/**
+ * Plays random games from every perft starting position with GameBoard_playout and
+ * a batch at a time with GameBoardBatch_playout.
+ */
+static void _bench_run_batch_playouts(int *is_first) {
+
+    const char *methods[] = { "kernel", "batch" };
+
+    for (int c = 0; c < BENCH_NUMBER_OF(bench_perft_cases); c++) {
+
+        BenchPerftCase *game = bench_perft_cases + c;
+        GameBoard *start = GameBoard_create(game->length, game->starting_seeds);
+
+        for (int method = 0; method < 2; method++) {
+
+            uint64_t random_state = GameBoard_seed_random(c + 1);
+            long long total_score_difference = 0;
+
+            long long start_ns = _bench_now_ns();
+
+            if (method == 0) {
+
+                for (int i = 0; i < BENCH_PLAYOUTS; i++) {
+                    GameBoard board = *start;
+                    total_score_difference += GameBoard_playout(&board, &random_state);
+                }
+
+            } else {
+
+                for (int i = 0; i < BENCH_PLAYOUTS; i += GAMEBOARD_BATCH_SIZE) {
+
+                    GameBoardBatch batch;
+                    GameBoardBatch_setup(&batch, game->length);
+                    for (int g = 0; g < GAMEBOARD_BATCH_SIZE; g++) {
+                        GameBoardBatch_set(&batch, g, start);
+                    }
+
+                    int score_differences[GAMEBOARD_BATCH_SIZE];
+                    GameBoardBatch_playout(&batch, &random_state, score_differences);
+                    for (int g = 0; g < GAMEBOARD_BATCH_SIZE; g++) {
+                        total_score_difference += score_differences[g];
+                    }
+
+                }
+
+            }
+
+            long long elapsed_ns = _bench_now_ns() - start_ns;
+
+            // The average score difference of random play should come out about the same either way.
+            printf("%s\n    {\"name\": \"%s\", \"method\": \"%s\", \"batch_size\": %d, \"playouts\": %d, \"mean_score_difference\": %.3f, \"time_ms\": %.3f, \"playouts_per_second\": %.0f}",
+                *is_first ? "" : ",", game->name, methods[method], method == 1 ? GAMEBOARD_BATCH_SIZE : 1, BENCH_PLAYOUTS,
+                (double) total_score_difference / BENCH_PLAYOUTS, elapsed_ns / 1e6, BENCH_PLAYOUTS * 1e9 / (elapsed_ns > 0 ? elapsed_ns : 1));
+            *is_first = 0;
+
+        }
+
+        GameBoard_delete(start);
+
+    }
+
+}
+
+int main(int argc, char** argv) {
+
+    #ifdef ARENA
+        int arena = 1;
+    #else
+        int arena = 0;
+    #endif
+
+    #ifdef POOL
+        int pool = 1;
+    #else
+        int pool = 0;
+    #endif
+
+    printf(
+        "{\n  \"build\": {\"arena\": %s, \"pool\": %s, \"max_length\": %d},\n",
+        arena ? "true" : "false", pool ? "true" : "false", GAMEBOARD_MAX_LENGTH
+    );
+
+    int is_first = 1;
+    printf("  \"perft\": [");
+    _bench_run_perft(&is_first);
+    printf("\n  ],\n");
+
+    is_first = 1;
+    printf("  \"search\": [");
+    _bench_run_search(&is_first);
+    printf("\n  ],\n");
+
+    is_first = 1;
+    printf("  \"algorithms\": [");
+    _bench_run_algorithms(&is_first);
+    printf("\n  ],\n");
+
+    is_first = 1;
+    printf("  \"threads\": [");
+    _bench_run_threads(&is_first);
+    printf("\n  ],\n");
+
+    is_first = 1;
+    printf("  \"games\": [");
+    _bench_run_games(&is_first);
+    printf("\n  ],\n");
+
+    is_first = 1;
+    printf("  \"sowing\": [");
+    _bench_run_sowing_equivalence(&is_first);
+    _bench_run_sowing_throughput(&is_first);
+    printf("\n  ],\n");
+
+    is_first = 1;
+    printf("  \"playouts\": [");
+    _bench_run_playouts(&is_first);
+    _bench_run_batch_equivalence(&is_first);
+    _bench_run_batch_playouts(&is_first);
+    printf("\n  ],\n");
+
+    printf("  \"failed\": %s\n}\n", bench_failed ? "true" : "false");
+
+    return bench_failed;
+
+}
@@ -0,0 +1,563 @@
+#include "mancala.h"
+#include "gametree.h"
+#include "mancala_search.h"
+#include "book.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OPENINGBOOK_MAGIC "MNCLBOOK"
+#define OPENINGBOOK_VERSION 1
+
+// The memory given to the transposition table shared by every search of a build.
+#define OPENINGBOOK_TABLE_SIZE (64 * 1024 * 1024)
+
+OpeningBook *OpeningBook_create() {
+
+    OpeningBook *book = malloc(sizeof(OpeningBook));
+    if (book == NULL) {
+        return NULL;
+    }
+
+    memset(book, 0, sizeof(OpeningBook));
+
+    return book;
+
+}
+
+OpeningBook *OpeningBook_load(const char *path) {
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    OpeningBookHeader header;
+    int is_valid = fread(&header, sizeof(OpeningBookHeader), 1, file) == 1;
+    is_valid = is_valid && memcmp(header.magic, OPENINGBOOK_MAGIC, sizeof(header.magic)) == 0;
+    is_valid = is_valid && header.version == OPENINGBOOK_VERSION;
+    is_valid = is_valid && header.number_configurations >= 0 && header.number_configurations <= OPENINGBOOK_MAX_CONFIGURATIONS;
+
+    OpeningBook *book = NULL;
+    if (is_valid) {
+        book = OpeningBook_create();
+    }
+
+    if (book != NULL && header.number_entries > 0) {
+
+        book->entries = malloc(header.number_entries * sizeof(OpeningBookEntry));
+        book->capacity = header.number_entries;
+
+        if (book->entries == NULL || fread(book->entries, sizeof(OpeningBookEntry), header.number_entries, file) != header.number_entries) {
+            OpeningBook_delete(book);
+            book = NULL;
+        }
+
+    }
+
+    fclose(file);
+
+    if (book == NULL) {
+        return NULL;
+    }
+
+    book->number_entries = header.number_entries;
+    book->number_configurations = header.number_configurations;
+    memcpy(book->configurations, header.configurations, sizeof(book->configurations));
+
+    return book;
+
+}
+
+void OpeningBook_delete(OpeningBook *book) {
+
+    free(book->entries);
+    free(book);
+
+}
+
+/**
+ * Orders entries by key, with the deepest search of a position first.
+ */
+static int _OpeningBookEntry_compare(const void *a, const void *b) {
+
+    const OpeningBookEntry *entry_a = a;
+    const OpeningBookEntry *entry_b = b;
+
+    if (entry_a->key != entry_b->key) {
+        return entry_a->key < entry_b->key ? -1 : 1;
+    }
+
+    return entry_b->depth - entry_a->depth;
+
+}
+
+/**
+ * Sorts the entries by key and keeps only the deepest entry of each position.
+ */
+static void _OpeningBook_sort(OpeningBook *book) {
+
+    if (!book->is_unsorted) {
+        return;
+    }
+
+    qsort(book->entries, book->number_entries, sizeof(OpeningBookEntry), &_OpeningBookEntry_compare);
+
+    size_t number_unique = 0;
+    for (size_t i = 0; i < book->number_entries; i++) {
+        if (number_unique == 0 || book->entries[number_unique - 1].key != book->entries[i].key) {
+            book->entries[number_unique] = book->entries[i];
+            number_unique++;
+        }
+    }
+
+    book->number_entries = number_unique;
+    book->is_unsorted = 0;
+
+}
+
+/**
+ * Adds an entry to the end of the book, leaving it unsorted.
+ *
+ * Returns 0 on success or -1 if the book could not grow.
+ */
+static int _OpeningBook_add(OpeningBook *book, OpeningBookEntry *entry) {
+
+    if (book->number_entries == book->capacity) {
+
+        size_t capacity = book->capacity > 0 ? book->capacity * 2 : 256;
+        OpeningBookEntry *entries = realloc(book->entries, capacity * sizeof(OpeningBookEntry));
+        if (entries == NULL) {
+            return -1;
+        }
+
+        book->entries = entries;
+        book->capacity = capacity;
+
+    }
+
+    book->entries[book->number_entries] = *entry;
+    book->number_entries++;
+    book->is_unsorted = 1;
+
+    return 0;
+
+}
+
+int OpeningBook_save(OpeningBook *book, const char *path) {
+
+    _OpeningBook_sort(book);
+
+    OpeningBookHeader header;
+    memset(&header, 0, sizeof(OpeningBookHeader));
+    memcpy(header.magic, OPENINGBOOK_MAGIC, sizeof(header.magic));
+    header.version = OPENINGBOOK_VERSION;
+    header.number_configurations = book->number_configurations;
+    memcpy(header.configurations, book->configurations, sizeof(header.configurations));
+    header.number_entries = book->number_entries;
+
+    // Write the whole book beside the old one, then swap it in.
+    char temporary_path[4096];
+    if (snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path) >= (int) sizeof(temporary_path)) {
+        return -1;
+    }
+
+    FILE *file = fopen(temporary_path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    int written = fwrite(&header, sizeof(OpeningBookHeader), 1, file) == 1;
+    written &= fwrite(book->entries, sizeof(OpeningBookEntry), book->number_entries, file) == book->number_entries;
+    written &= fclose(file) == 0;
+
+    if (!written || rename(temporary_path, path) != 0) {
+        remove(temporary_path);
+        return -1;
+    }
+
+    return 0;
+
+}
+
+uint64_t OpeningBook_key(GameBoard *board) {
+
+    // Boards of different lengths may share their pits, but are different games.
+    return GameBoard_hash(board) ^ (0x9e3779b97f4a7c15ULL * board->length);
+
+}
+
+int OpeningBook_probe(OpeningBook *book, GameBoard *board, OpeningBookEntry *entry) {
+
+    _OpeningBook_sort(book);
+
+    uint64_t key = OpeningBook_key(board);
+
+    size_t low = 0;
+    size_t high = book->number_entries;
+    while (low < high) {
+
+        size_t middle = low + (high - low) / 2;
+        if (book->entries[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+
+    }
+
+    if (low == book->number_entries || book->entries[low].key != key) {
+        return 0;
+    }
+
+    *entry = book->entries[low];
+    return 1;
+
+}
+
+/**
+ * A position to search while building a book.
+ */
+typedef struct {
+
+    uint64_t key;
+    GameBoard board;
+
+} _OpeningBookPosition;
+
+static int _OpeningBookPosition_compare(const void *a, const void *b) {
+
+    const _OpeningBookPosition *position_a = a;
+    const _OpeningBookPosition *position_b = b;
+
+    if (position_a->key == position_b->key) {
+        return 0;
+    }
+    return position_a->key < position_b->key ? -1 : 1;
+
+}
+
+/**
+ * Sorts positions by key and removes repeats, returning the number left.
+ */
+static size_t _OpeningBookPosition_unique(_OpeningBookPosition *positions, size_t number_positions) {
+
+    qsort(positions, number_positions, sizeof(_OpeningBookPosition), &_OpeningBookPosition_compare);
+
+    size_t number_unique = 0;
+    for (size_t i = 0; i < number_positions; i++) {
+        if (number_unique == 0 || positions[number_unique - 1].key != positions[i].key) {
+            positions[number_unique] = positions[i];
+            number_unique++;
+        }
+    }
+
+    return number_unique;
+
+}
+
+/**
+ * Lists every position within the given plies of a new game, including the first.
+ * Positions reached by different plays are listed once.
+ *
+ * Returns the number of positions or -1 if they could not be allocated.
+ */
+static long _OpeningBook_list_positions(int length, int starting_seeds, int plies, _OpeningBookPosition **positions) {
+
+    GameBoard *start = GameBoard_create(length, starting_seeds);
+    if (start == NULL) {
+        return -1;
+    }
+
+    size_t capacity = 256;
+    _OpeningBookPosition *list = malloc(capacity * sizeof(_OpeningBookPosition));
+    if (list == NULL) {
+        GameBoard_delete(start);
+        return -1;
+    }
+
+    list[0].key = OpeningBook_key(start);
+    list[0].board = *start;
+    size_t number_positions = 1;
+    GameBoard_delete(start);
+
+    // Each pass plays every move from the positions found by the last one.
+    size_t level_start = 0;
+    for (int ply = 0; ply < plies; ply++) {
+
+        size_t level_end = number_positions;
+        for (size_t i = level_start; i < level_end; i++) {
+
+            if (GameBoard_is_game_over(&(list[i].board))) {
+                continue;
+            }
+
+            int moves[GAMEBOARD_MAX_LENGTH];
+            int number_moves = GameBoard_get_moves(&(list[i].board), moves);
+
+            if (number_positions + number_moves > capacity) {
+
+                capacity = 2 * (number_positions + number_moves);
+                _OpeningBookPosition *grown = realloc(list, capacity * sizeof(_OpeningBookPosition));
+                if (grown == NULL) {
+                    free(list);
+                    return -1;
+                }
+                list = grown;
+
+            }
+
+            for (int j = 0; j < number_moves; j++) {
+
+                _OpeningBookPosition *next = list + number_positions;
+                next->board = list[i].board;
+                GameBoard_play_turn(&(next->board), moves[j]);
+                next->key = OpeningBook_key(&(next->board));
+                number_positions++;
+
+            }
+
+        }
+
+        // Only expand each new position once.
+        number_positions = level_end + _OpeningBookPosition_unique(list + level_end, number_positions - level_end);
+        level_start = level_end;
+
+    }
+
+    *positions = list;
+    return _OpeningBookPosition_unique(list, number_positions);
+
+}
+
+/**
+ * The shared state of a book being built across several threads.
+ */
+typedef struct {
+
+    OpeningBook *book;
+    const char *path;
+    int depth;
+
+    _OpeningBookPosition *positions;
+    size_t number_positions;
+
+    // The next position to search, taken by each thread in turn.
+    size_t next_position;
+
+    TranspositionTable *table;
+
+    // Guards everything below, and the book.
+    pthread_mutex_t lock;
+    size_t number_searched;
+    int unsaved;
+    int result;
+
+} _OpeningBookBuild;
+
+/**
+ * Searches a single position to the depth of the build and fills in its entry.
+ */
+static void _OpeningBookBuild_search(_OpeningBookBuild *build, GameBoard *board, OpeningBookEntry *entry) {
+
+    MinMaxSearch search;
+    memset(&search, 0, sizeof(MinMaxSearch));
+
+    search.options.max_depth = build->depth;
+    search.options.iterative_deepening = 1;
+    search.options.starting_depth = 1;
+    search.options.depth_step = 1;
+    search.options.time_limit_in_ms = -1;
+    search.options.aspiration_window = 2;
+    search.options.dead_state_pruning = 1;
+    search.options.alpha_beta_pruning = 1;
+    search.options.order_static = 1;
+    search.options.order_killers = 1;
+    search.options.order_history = 1;
+    search.options.threads = 1; // The build runs one search per thread instead.
+
+    GameBoard_setup_search(&search);
+    search.transposition_table = build->table;
+
+    MinMaxSearch_reset_stats(&search);
+
+    #ifdef ARENA
+        size_t arena_mark_before_search = arena_mark();
+    #endif
+
+    GameBoard root_board = *board;
+    Node root;
+    root.game_state = &root_board;
+    root.number_successors = -1;
+
+    Node *to_play = MinMaxSearch_search(&search, &root);
+
+    entry->key = OpeningBook_key(board);
+    entry->utility = search.best_utility;
+    entry->depth = build->depth;
+    entry->best_move = ((GameBoard *) to_play->game_state)->play_made.pit_played;
+    entry->reserved = 0;
+
+    root.game_state = NULL;
+    Node_cleanup(&root, search.free_state);
+
+    #ifdef ARENA
+        arena_reset_to(arena_mark_before_search);
+    #endif
+
+}
+
+/**
+ * Takes positions until none are left, adding each to the book and saving it every so often.
+ */
+static void *_OpeningBookBuild_run(void *argument) {
+
+    _OpeningBookBuild *build = argument;
+
+    while (1) {
+
+        size_t i = __atomic_fetch_add(&(build->next_position), 1, __ATOMIC_RELAXED);
+        if (i >= build->number_positions) {
+            break;
+        }
+
+        OpeningBookEntry entry;
+        _OpeningBookBuild_search(build, &(build->positions[i].board), &entry);
+
+        pthread_mutex_lock(&(build->lock));
+
+        if (_OpeningBook_add(build->book, &entry) != 0) {
+            build->result = -1;
+        }
+        build->number_searched++;
+        build->unsaved++;
+
+        if (build->unsaved >= OPENINGBOOK_SAVE_INTERVAL) {
+
+            build->unsaved = 0;
+            if (OpeningBook_save(build->book, build->path) != 0) {
+                build->result = -1;
+            }
+            printf("Searched %zu of %zu positions.\n", build->number_searched, build->number_positions);
+            fflush(stdout);
+
+        }
+
+        pthread_mutex_unlock(&(build->lock));
+
+    }
+
+    return NULL;
+
+}
+
+int OpeningBook_build(const char *path, int length, int starting_seeds, int plies, int depth, int threads) {
+
+    if (length < 1 || length > GAMEBOARD_MAX_LENGTH || starting_seeds < 0 || plies < 0 || depth < 1) {
+        return -1;
+    }
+
+    // Pick up from an earlier build if there is one.
+    OpeningBook *book = OpeningBook_load(path);
+    if (book == NULL) {
+        book = OpeningBook_create();
+    }
+    if (book == NULL) {
+        return -1;
+    }
+
+    // Record what this build covers, replacing an earlier build of the same game.
+    int configuration = 0;
+    while (configuration < book->number_configurations) {
+
+        OpeningBookConfiguration *existing = book->configurations + configuration;
+        if (existing->length == length && existing->starting_seeds == starting_seeds) {
+            break;
+        }
+        configuration++;
+
+    }
+
+    if (configuration == OPENINGBOOK_MAX_CONFIGURATIONS) {
+        OpeningBook_delete(book);
+        return -1;
+    }
+
+    if (configuration == book->number_configurations) {
+        book->number_configurations++;
+    }
+    book->configurations[configuration].length = length;
+    book->configurations[configuration].starting_seeds = starting_seeds;
+    book->configurations[configuration].plies = plies;
+    book->configurations[configuration].depth = depth;
+
+    _OpeningBookPosition *positions;
+    long number_positions = _OpeningBook_list_positions(length, starting_seeds, plies, &positions);
+    if (number_positions < 0) {
+        OpeningBook_delete(book);
+        return -1;
+    }
+
+    // Leave out finished games and positions already searched deep enough.
+    size_t number_left = 0;
+    for (long i = 0; i < number_positions; i++) {
+
+        OpeningBookEntry entry;
+        int is_done = GameBoard_is_game_over(&(positions[i].board));
+        is_done = is_done || (OpeningBook_probe(book, &(positions[i].board), &entry) && entry.depth >= depth);
+        if (!is_done) {
+            positions[number_left] = positions[i];
+            number_left++;
+        }
+
+    }
+
+    _OpeningBookBuild build;
+    memset(&build, 0, sizeof(_OpeningBookBuild));
+    build.book = book;
+    build.path = path;
+    build.depth = depth;
+    build.positions = positions;
+    build.number_positions = number_left;
+    build.table = TranspositionTable_create(OPENINGBOOK_TABLE_SIZE);
+    pthread_mutex_init(&(build.lock), NULL);
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int number_workers = 0;
+    if (workers != NULL && build.table != NULL) {
+
+        // The calling thread takes part as well.
+        while (number_workers < threads - 1 && pthread_create(workers + number_workers, NULL, &_OpeningBookBuild_run, &build) == 0) {
+            number_workers++;
+        }
+        _OpeningBookBuild_run(&build);
+
+        for (int i = 0; i < number_workers; i++) {
+            pthread_join(workers[i], NULL);
+        }
+
+    } else {
+        build.result = -1;
+    }
+
+    if (build.result == 0) {
+        build.result = OpeningBook_save(book, path);
+    }
+
+    pthread_mutex_destroy(&(build.lock));
+    if (build.table != NULL) {
+        TranspositionTable_delete(build.table);
+    }
+    free(workers);
+    free(positions);
+    OpeningBook_delete(book);
+
+    return build.result;
+
+}
@@ -0,0 +1,118 @@
+/**
+ *
+ * This file describes an opening book for Mancala.
+ *
+ * The book holds the best play and its utility for every position reachable in the
+ * first few plies of a game, found by a deep search ahead of time. A single book may
+ * cover several board lengths and starting seeds, each listed as a configuration.
+ *
+ * Entries are kept sorted by key, the hash of the position and its board length, so
+ * a lookup is a binary search. The whole book is written to a file at once and read
+ * back into memory.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// GameBoard comes from mancala.h, which must be included first.
+
+// The most configurations a single book may cover.
+#define OPENINGBOOK_MAX_CONFIGURATIONS 16
+
+// How many new entries are found between saves while building, so that an
+// interrupted build loses little and can pick up where it left off.
+#define OPENINGBOOK_SAVE_INTERVAL 64
+
+/**
+ * The games a book was built for.
+ */
+typedef struct {
+
+    int32_t length;
+    int32_t starting_seeds;
+    int32_t plies; // Positions up to this many plays in are covered.
+    int32_t depth; // The depth every position was searched to.
+
+} OpeningBookConfiguration;
+
+typedef struct {
+
+    uint64_t key;
+    int32_t utility; // For the player to play.
+    int16_t depth;
+    int8_t best_move;
+    int8_t reserved;
+
+} OpeningBookEntry;
+
+/**
+ * The start of a book file, followed by number_entries entries sorted by key.
+ */
+typedef struct {
+
+    char magic[8];
+    int32_t version;
+    int32_t number_configurations;
+    OpeningBookConfiguration configurations[OPENINGBOOK_MAX_CONFIGURATIONS];
+    uint64_t number_entries;
+
+} OpeningBookHeader;
+
+typedef struct {
+
+    int number_configurations;
+    OpeningBookConfiguration configurations[OPENINGBOOK_MAX_CONFIGURATIONS];
+
+    OpeningBookEntry *entries;
+    size_t number_entries;
+    size_t capacity;
+
+    // Set once entries have been added out of order, until the book is sorted again.
+    int is_unsorted;
+
+} OpeningBook;
+
+/**
+ * Allocates an empty book, or reads one from a file written by OpeningBook_save.
+ *
+ * Returns NULL if the book could not be allocated or the file could not be read
+ * or is not a valid book.
+ */
+OpeningBook *OpeningBook_create();
+OpeningBook *OpeningBook_load(const char *path);
+void OpeningBook_delete(OpeningBook *book);
+
+/**
+ * Writes the book to the given path, sorting it first.
+ * The file is replaced at once, so an interrupted save leaves the old book intact.
+ *
+ * Returns 0 on success or -1 if the file could not be written.
+ */
+int OpeningBook_save(OpeningBook *book, const char *path);
+
+/**
+ * Returns the key a board is kept under in a book.
+ */
+uint64_t OpeningBook_key(GameBoard *board);
+
+/**
+ * Looks up the board in the book.
+ * On a hit the entry is copied out, otherwise it is left untouched.
+ *
+ * Returns 1 if the board is in the book or 0 if not.
+ */
+int OpeningBook_probe(OpeningBook *book, GameBoard *board, OpeningBookEntry *entry);
+
+/**
+ * Searches every position within the given plies of a new game to the given depth,
+ * using the given number of threads, and adds them to the book at path.
+ *
+ * An existing book at path is kept and extended. Positions already in it at the same
+ * depth or deeper are not searched again, so an interrupted build resumes where it
+ * was last saved.
+ *
+ * Returns 0 on success or -1 if the arguments are out of range, the book has too
+ * many configurations or it could not be written.
+ */
+int OpeningBook_build(const char *path, int length, int starting_seeds, int plies, int depth, int threads);
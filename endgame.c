@@ -0,0 +1,385 @@
+#include "mancala.h"
+#include "endgame.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ENDGAME_MAGIC "MNCLENDG"
+#define ENDGAME_VERSION 1
+
+// Marks a position not yet solved while generating.
+#define ENDGAME_UNSOLVED INT8_MIN
+
+/**
+ * Fills in the binomial coefficients of the table up to its number of seeds and pits.
+ *
+ * Returns 0 if any of them is too large for 64 bits, as then so are the counts and
+ * ranks of its positions.
+ */
+static int _EndgameTable_fill_binomials(EndgameTable *table) {
+
+    int pits = 2 * table->length;
+    int rows = table->max_seeds + pits + 1;
+    memset(table->binomials, 0, sizeof(table->binomials));
+
+    for (int n = 0; n < rows; n++) {
+
+        table->binomials[n][0] = 1;
+        for (int k = 1; k <= n && k <= pits; k++) {
+
+            uint64_t below = k < n ? table->binomials[n - 1][k] : 0;
+            if (__builtin_add_overflow(table->binomials[n - 1][k - 1], below, &(table->binomials[n][k]))) {
+                return 0;
+            }
+
+        }
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Returns the number of positions with fewer than the given seeds in the pits.
+ */
+static inline uint64_t _EndgameTable_offset(EndgameTable *table, int seeds) {
+
+    if (seeds == 0) {
+        return 0;
+    }
+
+    int pits = 2 * table->length;
+    return table->binomials[seeds + pits - 1][pits];
+
+}
+
+/**
+ * Returns the index of a position given its pits, own lane first, and their total.
+ *
+ * Positions with the same total are ranked by the seeds in the first pit, then in
+ * the second and so on. The positions whose first pit holds fewer seeds than this
+ * one's are counted at once, as the compositions of the seeds left over the pits left.
+ */
+static inline uint64_t _EndgameTable_rank(EndgameTable *table, seed_t *pits, int seeds) {
+
+    int number_pits = 2 * table->length;
+
+    uint64_t rank = _EndgameTable_offset(table, seeds);
+    int seeds_left = seeds;
+    for (int i = 0; i < number_pits - 1; i++) {
+
+        int pits_after = number_pits - i - 1;
+        rank += table->binomials[seeds_left + pits_after][pits_after];
+        rank -= table->binomials[seeds_left - pits[i] + pits_after][pits_after];
+        seeds_left -= pits[i];
+
+    }
+
+    return rank;
+
+}
+
+/**
+ * Fills in the pits of the position with the given rank among those with the given total.
+ */
+static void _EndgameTable_unrank(EndgameTable *table, uint64_t rank, int seeds, seed_t *pits) {
+
+    int number_pits = 2 * table->length;
+
+    int seeds_left = seeds;
+    for (int i = 0; i < number_pits - 1; i++) {
+
+        int pits_after = number_pits - i - 1;
+
+        int in_pit = 0;
+        while (1) {
+
+            uint64_t count = table->binomials[seeds_left - in_pit + pits_after - 1][pits_after - 1];
+            if (rank < count) {
+                break;
+            }
+            rank -= count;
+            in_pit++;
+
+        }
+
+        pits[i] = in_pit;
+        seeds_left -= in_pit;
+
+    }
+
+    pits[number_pits - 1] = seeds_left;
+
+}
+
+/**
+ * Gathers the pits of a board from the view of the player to play and returns their total.
+ */
+static inline int _EndgameTable_gather(GameBoard *board, seed_t *pits) {
+
+    int length = board->length;
+    seed_t *own_lane = board->lanes[board->turn];
+    seed_t *other_lane = board->lanes[(board->turn + 1) % 2];
+
+    int seeds = 0;
+    for (int i = 0; i < length; i++) {
+        pits[i] = own_lane[i];
+        pits[length + i] = other_lane[i];
+        seeds += own_lane[i] + other_lane[i];
+    }
+
+    return seeds;
+
+}
+
+/**
+ * Returns the exact value of a board for the player to play, ignoring its stores.
+ *
+ * Every play either moves seeds out of the pits or moves them closer to the player's
+ * store, so positions with the same seeds never repeat. Positions are solved by seed
+ * count, fewest first, and those only reachable with the same count are solved here
+ * on the way down.
+ */
+static int _EndgameTable_solve(EndgameTable *table, int8_t *values, GameBoard *board) {
+
+    seed_t pits[ENDGAME_MAX_PITS];
+    int seeds = _EndgameTable_gather(board, pits);
+    uint64_t rank = _EndgameTable_rank(table, pits, seeds);
+
+    if (values[rank] != ENDGAME_UNSOLVED) {
+        return values[rank];
+    }
+
+    int player = board->turn;
+    int best;
+    if (GameBoard_is_game_over(board)) {
+
+        // The seeds left in each lane go to its owner.
+        best = 0;
+        for (int i = 0; i < board->length; i++) {
+            best += pits[i] - pits[board->length + i];
+        }
+
+    } else {
+
+        best = INT_MIN;
+
+        int moves[GAMEBOARD_MAX_LENGTH];
+        int number_moves = GameBoard_get_moves(board, moves);
+        for (int i = 0; i < number_moves; i++) {
+
+            // Only the player's own store can gain seeds on their play.
+            int gained = -board->stores[player];
+
+            GameBoardUndo undo;
+            GameBoard_make_move(board, moves[i], &undo);
+
+            gained += board->stores[player];
+            int rest = _EndgameTable_solve(table, values, board);
+            int value = board->turn == player ? gained + rest : gained - rest;
+
+            GameBoard_unmake_move(board, &undo);
+
+            if (value > best) {
+                best = value;
+            }
+
+        }
+
+    }
+
+    values[rank] = best;
+    return best;
+
+}
+
+int EndgameTable_generate(const char *path, int length, int max_seeds) {
+
+    if (length < 1 || length > GAMEBOARD_MAX_LENGTH || max_seeds < 0 || max_seeds > ENDGAME_MAX_SEEDS) {
+        return -1;
+    }
+
+    EndgameTable *table = malloc(sizeof(EndgameTable));
+    if (table == NULL) {
+        return -1;
+    }
+
+    table->length = length;
+    table->max_seeds = max_seeds;
+    if (!_EndgameTable_fill_binomials(table) || _EndgameTable_offset(table, max_seeds + 1) > SIZE_MAX) {
+        free(table);
+        return -1;
+    }
+    table->number_positions = _EndgameTable_offset(table, max_seeds + 1);
+
+    int8_t *values = malloc(table->number_positions);
+    if (values == NULL) {
+        free(table);
+        return -1;
+    }
+    memset(values, ENDGAME_UNSOLVED, table->number_positions);
+
+    // Solve every position, fewest seeds first.
+    GameBoard board;
+    memset(&board, 0, sizeof(GameBoard));
+    board.length = length;
+
+    for (int seeds = 0; seeds <= max_seeds; seeds++) {
+
+        uint64_t first = _EndgameTable_offset(table, seeds);
+        uint64_t last = _EndgameTable_offset(table, seeds + 1);
+        for (uint64_t rank = first; rank < last; rank++) {
+
+            if (values[rank] != ENDGAME_UNSOLVED) {
+                continue;
+            }
+
+            seed_t pits[ENDGAME_MAX_PITS];
+            _EndgameTable_unrank(table, rank - first, seeds, pits);
+
+            board.turn = 0;
+            board.stores[0] = 0;
+            board.stores[1] = 0;
+            for (int i = 0; i < length; i++) {
+                board.lanes[0][i] = pits[i];
+                board.lanes[1][i] = pits[length + i];
+            }
+            GameBoard_update_totals(&board);
+
+            _EndgameTable_solve(table, values, &board);
+
+        }
+
+    }
+
+    EndgameHeader header;
+    memset(&header, 0, sizeof(EndgameHeader));
+    memcpy(header.magic, ENDGAME_MAGIC, sizeof(header.magic));
+    header.version = ENDGAME_VERSION;
+    header.length = length;
+    header.max_seeds = max_seeds;
+    header.number_positions = table->number_positions;
+
+    int result = -1;
+    FILE *file = fopen(path, "wb");
+    if (file != NULL) {
+
+        int written = fwrite(&header, sizeof(EndgameHeader), 1, file) == 1;
+        written &= fwrite(values, 1, table->number_positions, file) == table->number_positions;
+        if (fclose(file) == 0 && written) {
+            result = 0;
+        }
+
+    }
+
+    free(values);
+    free(table);
+
+    return result;
+
+}
+
+EndgameTable *EndgameTable_open(const char *path) {
+
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return NULL;
+    }
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(EndgameHeader)) {
+        close(file);
+        return NULL;
+    }
+
+    size_t mapping_size = file_stat.st_size;
+    void *mapping = mmap(NULL, mapping_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    EndgameHeader *header = mapping;
+    int is_valid = memcmp(header->magic, ENDGAME_MAGIC, sizeof(header->magic)) == 0;
+    is_valid &= header->version == ENDGAME_VERSION;
+    is_valid &= header->length >= 1 && header->length <= GAMEBOARD_MAX_LENGTH;
+    is_valid &= header->max_seeds >= 0 && header->max_seeds <= ENDGAME_MAX_SEEDS;
+
+    EndgameTable *table = NULL;
+    if (is_valid) {
+        table = malloc(sizeof(EndgameTable));
+    }
+
+    if (table != NULL) {
+
+        table->length = header->length;
+        table->max_seeds = header->max_seeds;
+        int is_counted = _EndgameTable_fill_binomials(table);
+        table->number_positions = _EndgameTable_offset(table, table->max_seeds + 1);
+
+        // The file must hold exactly the positions its header describes.
+        if (!is_counted || header->number_positions != table->number_positions
+                || mapping_size - sizeof(EndgameHeader) != table->number_positions) {
+            free(table);
+            table = NULL;
+        }
+
+    }
+
+    if (table == NULL) {
+        munmap(mapping, mapping_size);
+        return NULL;
+    }
+
+    table->mapping = mapping;
+    table->mapping_size = mapping_size;
+    table->values = (const int8_t *) (header + 1);
+
+    return table;
+
+}
+
+void EndgameTable_close(EndgameTable *table) {
+
+    munmap(table->mapping, table->mapping_size);
+    free(table);
+
+}
+
+int EndgameTable_probe(EndgameTable *table, GameBoard *board, int for_player, int *utility) {
+
+    if (board->length != table->length) {
+        return 0;
+    }
+
+    seed_t pits[ENDGAME_MAX_PITS];
+    int seeds = _EndgameTable_gather(board, pits);
+    if (seeds > table->max_seeds) {
+        return 0;
+    }
+
+    int value = table->values[_EndgameTable_rank(table, pits, seeds)];
+
+    // Add the stores back in to find who finishes ahead.
+    int other_player = (for_player + 1) % 2;
+    int lead = board->stores[for_player] - board->stores[other_player];
+    lead += board->turn == for_player ? value : -value;
+
+    if (lead > 0) {
+        *utility = INT_MAX;
+    } else if (lead < 0) {
+        *utility = -INT_MAX;
+    } else {
+        *utility = 0;
+    }
+
+    return 1;
+
+}
@@ -0,0 +1,88 @@
+/**
+ *
+ * This file describes an endgame database for Mancala.
+ *
+ * The database holds the exact value of every position of a given board length
+ * with at most max_seeds seeds left in the pits. The value of a position is the
+ * most the player to play can finish ahead by, counting only the seeds still in
+ * the pits, when both players play perfectly. The stores do not change how the
+ * rest of the game is played, so they are left out and added back when probing.
+ *
+ * Positions are seen from the player to play, so one entry covers both players.
+ * Each is ranked densely by its seed count and then by the seeds in each pit, own
+ * lane first, and its value is kept in a single byte at that rank.
+ *
+ * The database is generated once and written to a file, which is then mapped
+ * into memory read-only and may be shared between threads and processes.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// GameBoard comes from mancala.h, which must be included first.
+
+// The most seeds a database may cover, so that every value fits in a byte.
+#define ENDGAME_MAX_SEEDS 126
+
+// The number of pits on a board of the largest length.
+#define ENDGAME_MAX_PITS (2 * GAMEBOARD_MAX_LENGTH)
+
+/**
+ * The start of a database file, followed by one int8_t value per position.
+ */
+typedef struct {
+
+    char magic[8];
+    int32_t version;
+    int32_t length;
+    int32_t max_seeds;
+    int32_t reserved;
+    uint64_t number_positions;
+
+} EndgameHeader;
+
+typedef struct {
+
+    // The mapped file and its size.
+    void *mapping;
+    size_t mapping_size;
+
+    int length;
+    int max_seeds;
+    uint64_t number_positions;
+
+    // One value per position, following the header in the mapping.
+    const int8_t *values;
+
+    // Binomial coefficients used to rank positions, binomials[n][k] = n choose k.
+    uint64_t binomials[ENDGAME_MAX_SEEDS + ENDGAME_MAX_PITS + 1][ENDGAME_MAX_PITS + 1];
+
+} EndgameTable;
+
+/**
+ * Solves every position of the given length with at most max_seeds seeds in the
+ * pits and writes the database to the given path.
+ *
+ * Returns 0 on success or -1 if the arguments are out of range, there are too many
+ * positions to count in 64 bits, memory could not be allocated or the file could
+ * not be written.
+ */
+int EndgameTable_generate(const char *path, int length, int max_seeds);
+
+/**
+ * Maps and unmaps a database file generated by EndgameTable_generate.
+ *
+ * Returns NULL if the file could not be opened or is not a valid database.
+ */
+EndgameTable *EndgameTable_open(const char *path);
+void EndgameTable_close(EndgameTable *table);
+
+/**
+ * Looks up the board in the database.
+ * If the board is covered, sets utility to what GameBoard_utility would return
+ * for the given player once the game is played out perfectly.
+ *
+ * Returns 1 if the board is covered or 0 if not.
+ */
+int EndgameTable_probe(EndgameTable *table, GameBoard *board, int for_player, int *utility);
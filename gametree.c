@@ -1,5 +1,6 @@
 
 #include "gametree.h"
+#include "gametree_internal.h"
 
 #include <stddef.h>
 #include <stdlib.h>
@@ -7,6 +8,68 @@
 #include <stdint.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef POOL
+    #include "pool.h"
+
+    // Successor arrays up to this long come from a pool, longer ones from malloc.
+    #define NODE_POOL_MAX_SUCCESSORS 16
+
+    // The number of successor arrays carved from memory at once.
+    #define NODE_POOL_SLAB 1024
+
+    // Every thread shares one pool of successor arrays, created on first use.
+    static Pool *node_pool;
+    static pthread_once_t node_pool_once = PTHREAD_ONCE_INIT;
+
+    static void _node_pool_create() {
+
+        node_pool = Pool_create(sizeof(Node) * NODE_POOL_MAX_SUCCESSORS, NODE_POOL_SLAB);
+
+    }
+
+    void Node_print_pool() {
+
+        if (node_pool != NULL) {
+            Pool_print(node_pool);
+        }
+
+    }
+
+#endif
+
+/**
+ * Allocates and frees the successor array of a node.
+ */
+static inline Node *_Node_allocate_successors(int number_successors) {
+
+#ifdef POOL
+    if (number_successors <= NODE_POOL_MAX_SUCCESSORS) {
+        pthread_once(&node_pool_once, &_node_pool_create);
+        if (node_pool != NULL) {
+            return Pool_allocate(node_pool);
+        }
+    }
+#endif
+
+    return malloc(sizeof(Node) * number_successors);
+
+}
+
+static inline void _Node_free_successors(Node *successors, int number_successors) {
+
+#ifdef POOL
+    if (number_successors <= NODE_POOL_MAX_SUCCESSORS && node_pool != NULL) {
+        Pool_free(node_pool, successors);
+        return;
+    }
+#endif
+
+    free(successors);
+
+}
 
 void Node_cleanup(Node *node, void (*free_state) (void *state)) {
 
@@ -18,118 +81,1037 @@ void Node_cleanup(Node *node, void (*free_state) (void *state)) {
         free_state(node->game_state);
     }
 
-    free(node->successors);
+    _Node_free_successors(node->successors, node->number_successors);
+
+}
+
+/**
+ * Returns the ratio of two counts, or a negative number without a denominator.
+ */
+static inline double _ratio(long long numerator, long long denominator) {
+
+    return denominator > 0 ? (double) numerator / denominator : -1.0;
+
+}
+
+#ifdef SEARCH_STATS
+/**
+ * Returns the number of plies with any stats, so trailing empty plies are left out.
+ */
+static int _MinMaxSearch_number_stats_plies(MinMaxSearch *search) {
+
+    int number_plies = 0;
+    for (int ply = 0; ply < MINMAXSEARCH_MAX_STATS_PLY; ply++) {
+        if (search->stats.plies[ply].nodes_explored > 0 || search->stats.plies[ply].nodes_generated > 0) {
+            number_plies = ply + 1;
+        }
+    }
+
+    return number_plies;
+
+}
+#endif
+
+/**
+ * The effective branching factor of an iteration, as its nodes over the previous iteration's.
+ */
+static inline double _MinMaxSearch_iteration_branching(MinMaxSearch *search, int i) {
+
+    return i > 0 ? _ratio(search->stats.iteration_nodes[i], search->stats.iteration_nodes[i - 1]) : -1.0;
 
 }
 
-void MinMaxSearch_print_stats(MinMaxSearch *search) {
-    printf(
-        "%d Nodes generated and %d explored in %dms and %dus.\n",
+static void _MinMaxSearch_write_text(MinMaxSearch *search, FILE *file) {
+
+    fprintf(
+        file,
+        "%lld Nodes generated and %lld explored with %lld alpha and %lld beta cutoffs in %lldms and %lldus.\n",
         search->stats.nodes_generated,
         search->stats.nodes_explored,
+        search->stats.alpha_cutoffs,
+        search->stats.beta_cutoffs,
         search->stats.elapsed_time_ms,
         search->stats.elapsed_time_us
     );
+
+    if (search->stats.nodes_ordered > 0) {
+        fprintf(
+            file,
+            "The first child was the best in %lld of %lld nodes (%.1f%%).\n",
+            search->stats.first_child_best,
+            search->stats.nodes_ordered,
+            100.0 * search->stats.first_child_best / search->stats.nodes_ordered
+        );
+    }
+
+    if (search->stats.table_probes > 0) {
+        fprintf(
+            file,
+            "Transposition table: %lld probes, %.1f%% hits, %.1f%% collisions and %lld stores.\n",
+            search->stats.table_probes,
+            100.0 * search->stats.table_hits / search->stats.table_probes,
+            100.0 * search->stats.table_collisions / search->stats.table_probes,
+            search->stats.table_stores
+        );
+    }
+
+    if (search->stats.endgame_hits > 0) {
+        fprintf(file, "Endgame database: %lld hits.\n", search->stats.endgame_hits);
+    }
+
+    if (search->stats.pvs_researches > 0) {
+        fprintf(file, "PVS: %lld children searched again in full.\n", search->stats.pvs_researches);
+    }
+
+    if (search->stats.iterations > 0) {
+        fprintf(file, "Completed depth %d in %d iterations", search->stats.completed_depth, search->stats.iterations);
+        if (search->stats.aspiration_researches > 0) {
+            fprintf(file, " with %d aspiration re-searches", search->stats.aspiration_researches);
+        }
+        if (search->stats.mtdf_passes > 0) {
+            fprintf(file, " with %d MTD(f) passes", search->stats.mtdf_passes);
+        }
+        fprintf(file, ":");
+        for (int i = 0; i < search->stats.iterations && i < MINMAXSEARCH_MAX_PV; i++) {
+            fprintf(file, " %d in %lldus", search->stats.iteration_depth[i], search->stats.iteration_time_us[i]);
+        }
+        fprintf(file, ".\nPrincipal variation:");
+        for (int i = 0; i < search->pv.previous_length; i++) {
+            fprintf(file, " %d", search->pv.previous[i]);
+        }
+        fprintf(file, ".\n");
+    }
+
+    #ifdef SEARCH_STATS
+        int number_plies = _MinMaxSearch_number_stats_plies(search);
+        if (number_plies > 0) {
+            fprintf(file, "Ply  Generated   Explored  Branching     Leaves  Terminal      Dead   Cutoffs  Table hits  Endgame\n");
+        }
+        for (int ply = 0; ply < number_plies; ply++) {
+
+            MinMaxSearchPlyStats *stats = search->stats.plies + ply;
+            double branching = ply + 1 < number_plies ? _ratio(search->stats.plies[ply + 1].nodes_explored, stats->nodes_explored) : -1.0;
+            fprintf(file, "%3d %10lld %10lld ", ply, stats->nodes_generated, stats->nodes_explored);
+            if (branching < 0) {
+                fprintf(file, "%10s", "-");
+            } else {
+                fprintf(file, "%10.2f", branching);
+            }
+            fprintf(
+                file, " %10lld %9lld %9lld %9lld %11lld %8lld\n",
+                stats->leaf_nodes, stats->terminal_nodes, stats->dead_states, stats->cutoffs,
+                stats->table_hits, stats->endgame_hits
+            );
+
+        }
+    #endif
+
 }
 
-int _max(int a, int b) {
-    if (a > b) {
-        return a;
+/**
+ * Writes a ratio as a JSON number, or null without a denominator.
+ */
+static inline void _write_json_ratio(FILE *file, double ratio) {
+
+    if (ratio < 0) {
+        fprintf(file, "null");
+    } else {
+        fprintf(file, "%.3f", ratio);
     }
-    return b;
+
 }
 
-int _min(int a, int b) {
-    if (a < b) {
-        return a;
+static void _MinMaxSearch_write_json(MinMaxSearch *search, FILE *file) {
+
+    fprintf(
+        file,
+        "{\"nodes_generated\": %lld, \"nodes_explored\": %lld, \"alpha_cutoffs\": %lld, \"beta_cutoffs\": %lld, "
+        "\"nodes_ordered\": %lld, \"first_child_best\": %lld, \"table_probes\": %lld, \"table_hits\": %lld, "
+        "\"table_collisions\": %lld, \"table_stores\": %lld, \"endgame_hits\": %lld, \"completed_depth\": %d, "
+        "\"aspiration_researches\": %d, \"pvs_researches\": %lld, \"mtdf_passes\": %d, \"time_us\": %lld",
+        search->stats.nodes_generated, search->stats.nodes_explored,
+        search->stats.alpha_cutoffs, search->stats.beta_cutoffs,
+        search->stats.nodes_ordered, search->stats.first_child_best,
+        search->stats.table_probes, search->stats.table_hits,
+        search->stats.table_collisions, search->stats.table_stores,
+        search->stats.endgame_hits, search->stats.completed_depth,
+        search->stats.aspiration_researches, search->stats.pvs_researches, search->stats.mtdf_passes,
+        search->stats.elapsed_time_ms * 1000 + search->stats.elapsed_time_us
+    );
+
+    fprintf(file, ", \"iterations\": [");
+    for (int i = 0; i < search->stats.iterations && i < MINMAXSEARCH_MAX_PV; i++) {
+        fprintf(
+            file, "%s{\"depth\": %d, \"nodes_explored\": %lld, \"branching_factor\": ",
+            i > 0 ? ", " : "", search->stats.iteration_depth[i], search->stats.iteration_nodes[i]
+        );
+        _write_json_ratio(file, _MinMaxSearch_iteration_branching(search, i));
+        fprintf(file, ", \"time_us\": %lld}", search->stats.iteration_time_us[i]);
+    }
+
+    fprintf(file, "], \"principal_variation\": [");
+    for (int i = 0; i < search->pv.previous_length; i++) {
+        fprintf(file, "%s%d", i > 0 ? ", " : "", search->pv.previous[i]);
     }
-    return b;
+    fprintf(file, "]");
+
+    #ifdef SEARCH_STATS
+        int number_plies = _MinMaxSearch_number_stats_plies(search);
+        fprintf(file, ", \"plies\": [");
+        for (int ply = 0; ply < number_plies; ply++) {
+
+            MinMaxSearchPlyStats *stats = search->stats.plies + ply;
+            fprintf(
+                file,
+                "%s{\"ply\": %d, \"nodes_generated\": %lld, \"nodes_explored\": %lld, \"branching_factor\": ",
+                ply > 0 ? ", " : "", ply, stats->nodes_generated, stats->nodes_explored
+            );
+            _write_json_ratio(file, ply + 1 < number_plies ? _ratio(search->stats.plies[ply + 1].nodes_explored, stats->nodes_explored) : -1.0);
+            fprintf(
+                file,
+                ", \"leaf_nodes\": %lld, \"terminal_nodes\": %lld, \"dead_states\": %lld, \"cutoffs\": %lld, "
+                "\"table_probes\": %lld, \"table_hits\": %lld, \"endgame_hits\": %lld}",
+                stats->leaf_nodes, stats->terminal_nodes, stats->dead_states, stats->cutoffs,
+                stats->table_probes, stats->table_hits, stats->endgame_hits
+            );
+
+        }
+        fprintf(file, "]");
+    #endif
+
+    fprintf(file, "}");
+
 }
 
-int _time_left(struct timespec start_time, int allowed_ms) {
+/**
+ * Writes a ratio as a CSV field, left empty without a denominator.
+ */
+static inline void _write_csv_ratio(FILE *file, double ratio) {
+
+    if (ratio >= 0) {
+        fprintf(file, "%.3f", ratio);
+    }
 
-    struct timespec end_time;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
-    long ms_elapsed = 1000 * (end_time.tv_sec - start_time.tv_sec);
-    long ns_elapsed = end_time.tv_nsec - start_time.tv_nsec;
+}
 
-    if (ns_elapsed < 0) {
-        ms_elapsed -= 1000;
+static void _MinMaxSearch_write_csv(MinMaxSearch *search, FILE *file) {
+
+    fprintf(
+        file,
+        "kind,index,depth,nodes_generated,nodes_explored,branching_factor,leaf_nodes,terminal_nodes,"
+        "dead_states,cutoffs,table_probes,table_hits,endgame_hits,time_us\n"
+    );
+
+    // Counts only broken down per ply are left empty in the totals.
+    fprintf(
+        file, "total,,%d,%lld,%lld,,,,,%lld,%lld,%lld,%lld,%lld\n",
+        search->stats.completed_depth, search->stats.nodes_generated, search->stats.nodes_explored,
+        search->stats.alpha_cutoffs + search->stats.beta_cutoffs,
+        search->stats.table_probes, search->stats.table_hits, search->stats.endgame_hits,
+        search->stats.elapsed_time_ms * 1000 + search->stats.elapsed_time_us
+    );
+
+    for (int i = 0; i < search->stats.iterations && i < MINMAXSEARCH_MAX_PV; i++) {
+        fprintf(file, "iteration,%d,%d,,%lld,", i, search->stats.iteration_depth[i], search->stats.iteration_nodes[i]);
+        _write_csv_ratio(file, _MinMaxSearch_iteration_branching(search, i));
+        fprintf(file, ",,,,,,,,%lld\n", search->stats.iteration_time_us[i]);
     }
 
-    return allowed_ms - ms_elapsed;
+    #ifdef SEARCH_STATS
+        int number_plies = _MinMaxSearch_number_stats_plies(search);
+        for (int ply = 0; ply < number_plies; ply++) {
+
+            MinMaxSearchPlyStats *stats = search->stats.plies + ply;
+            fprintf(file, "ply,%d,,%lld,%lld,", ply, stats->nodes_generated, stats->nodes_explored);
+            _write_csv_ratio(file, ply + 1 < number_plies ? _ratio(search->stats.plies[ply + 1].nodes_explored, stats->nodes_explored) : -1.0);
+            fprintf(
+                file, ",%lld,%lld,%lld,%lld,%lld,%lld,%lld,\n",
+                stats->leaf_nodes, stats->terminal_nodes, stats->dead_states, stats->cutoffs,
+                stats->table_probes, stats->table_hits, stats->endgame_hits
+            );
+
+        }
+    #endif
 
 }
 
+void MinMaxSearch_write_stats(MinMaxSearch *search, FILE *file, int format) {
+
+    if (format == MINMAXSEARCH_STATS_JSON) {
+        _MinMaxSearch_write_json(search, file);
+    } else if (format == MINMAXSEARCH_STATS_CSV) {
+        _MinMaxSearch_write_csv(search, file);
+    } else {
+        _MinMaxSearch_write_text(search, file);
+    }
+
+}
+
+/**
+ * Keeps a utility within -INT_MAX and INT_MAX, so that it can still be negated.
+ */
+static inline int _clamp(long long utility) {
+
+    if (utility > INT_MAX) {
+        return INT_MAX;
+    }
+    if (utility < -INT_MAX) {
+        return -INT_MAX;
+    }
+    return utility;
+
+}
+
+void _MinMaxSearch_discard_successors(MinMaxSearch *search, Node *root) {
+
+    for (int i = 0; i < root->number_successors; i++) {
+        Node_cleanup(root->successors + i, search->free_state);
+    }
+
+    _Node_free_successors(root->successors, root->number_successors);
+    root->successors = NULL;
+    root->number_successors = -1;
+
+}
+
+// The search below the root, calling the game through the search's function pointers.
+#define MINMAXSEARCH_NAME(name) name
+#define MINMAXSEARCH_IS_IN_PLACE(search) _MinMaxSearch_is_in_place(search)
+#define MINMAXSEARCH_UTILITY(search, state, for_player) (search)->utility((state), (for_player))
+#define MINMAXSEARCH_IS_TERMINAL(search, state) (search)->is_terminal(state)
+#define MINMAXSEARCH_GET_TURN(search, state) (search)->get_turn(state)
+#define MINMAXSEARCH_IS_DEAD_STATE(search, state, for_player) (search)->is_dead_state((state), (for_player))
+#define MINMAXSEARCH_GET_MOVES(search, state, moves) (search)->get_moves((state), (moves))
+#define MINMAXSEARCH_MAKE_MOVE(search, state, move, undo) (search)->make_move((state), (move), (undo))
+#define MINMAXSEARCH_UNMAKE_MOVE(search, state, undo) (search)->unmake_move((state), (undo))
+#define MINMAXSEARCH_MOVE_HINT(search, state, move) (search)->move_hint((state), (move))
+#define MINMAXSEARCH_HASH(search, state) (search)->hash(state)
+#include "gametree_search.h"
+
 /**
- * The inner search function which returns utility values instead of nodes.
+ * Searches a node below the root, with the game's own instance of the search if it has one.
  */
-int _MinMaxSearch_search_inner(MinMaxSearch *search, Node *root, int max_player, int depth, struct timespec start_time) {
+static inline int _MinMaxSearch_search_node(MinMaxSearch *search, Node *root, int player, int depth, int alpha, int beta) {
 
-    // We are exploring a new node.
-    search->stats.nodes_explored++;
+    if (search->search_node) {
+        return search->search_node(search, root, player, depth, alpha, beta);
+    }
+
+    return _MinMaxSearch_search_inner(search, root, player, depth, alpha, beta);
 
-    // Check if our node is at depth, terminal, or we are out of time.
-    int at_depth = depth <= 0;
-    int is_terminal = search->is_terminal(root->game_state);
-    int is_time_left = _time_left(start_time, search->options.time_limit_in_ms) > 0;
-    if (at_depth || is_terminal || !is_time_left) {
-        return search->utility(root->game_state, max_player);
+}
+
+/**
+ * Searches a child of the root or of a split point as _MinMaxSearch_search_child does,
+ * with the game's own instance of the search if it has one.
+ */
+static inline int _MinMaxSearch_search_child_node(MinMaxSearch *search, Node *child, int player, int depth, int alpha, int beta, int is_scout) {
+
+    if (!is_scout || alpha + 1 >= beta) {
+        return _MinMaxSearch_search_node(search, child, player, depth, alpha, beta);
     }
 
-    int is_max = max_player == search->get_turn(root->game_state);
+    int utility = _MinMaxSearch_search_node(search, child, player, depth, alpha, alpha + 1);
+    if (utility > alpha && utility < beta && !_MinMaxSearch_is_stopped(search)) {
+        search->stats.pvs_researches++;
+        utility = _MinMaxSearch_search_node(search, child, player, depth, alpha, beta);
+    }
 
-    // Check if this is a dead state.
-    if (search->options.dead_state_pruning) {
+    return utility;
 
-        int is_dead = search->is_dead_state(root->game_state, search->get_turn(root->game_state));
-        if (is_dead && is_max) {
-            return INT_MIN;
+}
+
+/**
+ * Checks if the children after the first should only be scouted with a null window.
+ */
+static inline int _MinMaxSearch_is_pvs(MinMaxSearch *search) {
+
+    return search->options.alpha_beta_pruning && search->options.algorithm == MINMAXSEARCH_PVS;
+
+}
+
+/**
+ * Moves an empty deque back to the start, so that the slots of stolen tasks are used
+ * again. Must be called while holding the deque's lock.
+ */
+static inline void _Deque_reset_if_empty(_Deque *deque) {
+
+    if (deque->top == deque->bottom) {
+        deque->top = 0;
+        deque->bottom = 0;
+    }
+
+}
+
+/**
+ * Takes the newest task from the bottom of a thread's own deque, but only if it
+ * belongs to the given split point (or any split point when NULL).
+ */
+static int _Deque_pop(_Deque *deque, _SplitPoint *split, _Task *task) {
+
+    int found = 0;
+
+    pthread_mutex_lock(&(deque->lock));
+    if (deque->bottom > deque->top) {
+
+        _Task *newest = deque->tasks + deque->bottom - 1;
+        if (split == NULL || newest->split == split) {
+            *task = *newest;
+            deque->bottom--;
+            found = 1;
         }
-        if (is_dead) {
-            return INT_MAX;
+
+    }
+    _Deque_reset_if_empty(deque);
+    pthread_mutex_unlock(&(deque->lock));
+
+    return found;
+
+}
+
+/**
+ * Takes the oldest task from the top of another thread's deque.
+ */
+static int _Deque_steal(_Deque *deque, _Task *task) {
+
+    int found = 0;
+
+    pthread_mutex_lock(&(deque->lock));
+    if (deque->bottom > deque->top) {
+        *task = deque->tasks[deque->top];
+        deque->top++;
+        found = 1;
+    }
+    _Deque_reset_if_empty(deque);
+    pthread_mutex_unlock(&(deque->lock));
+
+    return found;
+
+}
+
+/**
+ * Finds a task for an idle thread, first from its own deque, then from the others.
+ */
+static int _SearchWorker_take_task(_SearchWorker *worker, _Task *task) {
+
+    _SearchPool *pool = worker->pool;
+
+    int found = _Deque_pop(&(worker->deque), NULL, task);
+    for (int i = 1; !found && i < pool->number_workers; i++) {
+        _SearchWorker *victim = pool->workers + (worker->id + i) % pool->number_workers;
+        found = _Deque_steal(&(victim->deque), task);
+    }
+
+    if (found) {
+        __atomic_fetch_sub(&(pool->tasks_queued), 1, __ATOMIC_RELAXED);
+    }
+
+    return found;
+
+}
+
+/**
+ * Folds the utility of one child into its split point.
+ * Must be called while holding the split point's lock.
+ */
+static void _SplitPoint_update(_SplitPoint *split, MinMaxSearch *search, int ordered_child, int utility) {
+
+    int i = split->order[ordered_child];
+    int ply = search->depth - split->depth;
+
+    // Ties at the root go to the first child.
+    int improved = utility > split->best_utility;
+    if (split->is_root) {
+        split->utilities[i] = utility;
+        split->searched[i] = 1;
+        improved |= utility == split->best_utility && (split->best_move < 0 || i < split->best_move);
+    }
+
+    if (improved) {
+
+        split->best_utility = utility;
+        split->best_move = split->moves[i];
+        split->best_ordered_child = ordered_child;
+
+        // Keep the line below this child, which lives in this thread's own table.
+        split->best_is_task = 1;
+        if (ply + 1 < MINMAXSEARCH_MAX_PV) {
+            for (int j = ply + 1; j < search->pv.length[ply + 1]; j++) {
+                split->pv[j] = search->pv.moves[ply + 1][j];
+            }
+            split->pv_length = search->pv.length[ply + 1];
         }
 
     }
 
-    // Generate the successors of this node.
-    int number_successors = MinMaxSearch_generate_successor_nodes(search, root);
+    if (!search->options.alpha_beta_pruning) {
+        return;
+    }
 
-    // Now, we may explore the successor nodes.
-    int (*eval_function)(int, int);
+    split->alpha = _max(split->alpha, split->best_utility);
 
-    int best_utility;
-    if (is_max) {
-        eval_function = &_max;
-        best_utility = INT_MIN;
-    } else {
-        eval_function = &_min;
-        best_utility = INT_MAX;
+    if (split->alpha >= split->beta && !split->cutoff) {
+
+        // The root only cuts off when the aspiration window fails high.
+        if (split->is_root) {
+            if (split->beta < INT_MAX) {
+                __atomic_store_n(&(split->cutoff), 1, __ATOMIC_RELAXED);
+            }
+            return;
+        }
+
+        __atomic_store_n(&(split->cutoff), 1, __ATOMIC_RELAXED);
+
+        if (split->player == search->max_player) {
+            search->stats.beta_cutoffs++;
+        } else {
+            search->stats.alpha_cutoffs++;
+        }
+        _MINMAXSEARCH_PLY_STAT(search, ply, cutoffs, 1);
+
+        _MinMaxSearch_record_cutoff(search, split->player, split->moves[i], ply, split->depth);
+
+    }
+
+}
+
+/**
+ * Searches a single child of a split point on the given thread.
+ */
+static void _SearchWorker_run_task(_SearchWorker *worker, _Task task) {
+
+    _SplitPoint *split = task.split;
+    MinMaxSearch *search = worker->search;
+    int i = split->order[task.ordered_child];
+
+    pthread_mutex_lock(&(split->lock));
+    int alpha = split->alpha;
+    int beta = split->beta;
+    int is_skipped = split->cutoff;
+    pthread_mutex_unlock(&(split->lock));
+
+    is_skipped |= _SplitPoint_is_abandoned(split->parent);
+
+    if (!is_skipped) {
+
+        // The root must tell a child equal to the best so far from a worse one, as ties
+        // go to the first child. Searching just below alpha makes equal utilities exact.
+        if (split->is_root && alpha > -INT_MAX) {
+            alpha--;
+        }
+
+        // Searching in place, the child needs a state of its own.
+        Node copy;
+        Node *child = split->root->successors + i;
+        if (_MinMaxSearch_is_in_place(search) && !split->is_root) {
+
+            _Alignas(max_align_t) unsigned char undo[MINMAXSEARCH_MAX_UNDO_SIZE];
+            copy.game_state = search->copy_state(split->root->game_state);
+            copy.number_successors = -1;
+            copy.successors = NULL;
+            search->make_move(copy.game_state, split->moves[i], undo);
+            child = &copy;
+
+        }
+
+        // Only the first child of a node can lie on the previous principal variation.
+        search->pv.is_following = 0;
+
+        _SplitPoint *previous = worker->split;
+        worker->split = split;
+        // Every task follows the first child, so with PVS it is only scouted at first.
+        int utility = _MinMaxSearch_search_child_node(search, child, split->player, split->depth - 1, alpha, beta, _MinMaxSearch_is_pvs(search));
+        int is_stopped = _MinMaxSearch_is_stopped(search);
+        worker->split = previous;
+
+        if (child == &copy) {
+            search->free_state(copy.game_state);
+        }
+
+        pthread_mutex_lock(&(split->lock));
+        if (!is_stopped) {
+            _SplitPoint_update(split, search, task.ordered_child, utility);
+        }
+        pthread_mutex_unlock(&(split->lock));
+
+    }
+
+    pthread_mutex_lock(&(split->lock));
+    split->tasks_left--;
+    if (split->tasks_left == 0) {
+        pthread_cond_broadcast(&(split->done));
+    }
+    pthread_mutex_unlock(&(split->lock));
+
+}
+
+void _MinMaxSearch_split(MinMaxSearch *search, _SplitPoint *split, int first_child, int number_successors) {
+
+    _SearchWorker *worker = search->worker;
+    _SearchPool *pool = worker->pool;
+
+    split->parent = worker->split;
+    split->cutoff = 0;
+    split->best_is_task = 0;
+    split->tasks_left = number_successors - first_child;
+    pthread_mutex_init(&(split->lock), NULL);
+    pthread_cond_init(&(split->done), NULL);
+
+    // Queue the children so that the best ordered is popped first.
+    pthread_mutex_lock(&(worker->deque.lock));
+    for (int k = number_successors - 1; k >= first_child; k--) {
+        _Task *task = worker->deque.tasks + worker->deque.bottom;
+        task->split = split;
+        task->ordered_child = k;
+        worker->deque.bottom++;
+    }
+    pthread_mutex_unlock(&(worker->deque.lock));
+
+    pthread_mutex_lock(&(pool->lock));
+    __atomic_fetch_add(&(pool->tasks_queued), number_successors - first_child, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&(pool->work_available));
+    pthread_mutex_unlock(&(pool->lock));
+
+    // Help with our own children until none are left to start.
+    _Task task;
+    while (_Deque_pop(&(worker->deque), split, &task)) {
+        __atomic_fetch_sub(&(pool->tasks_queued), 1, __ATOMIC_RELAXED);
+        _SearchWorker_run_task(worker, task);
+    }
+
+    pthread_mutex_lock(&(split->lock));
+    while (split->tasks_left > 0) {
+        pthread_cond_wait(&(split->done), &(split->lock));
+    }
+    pthread_mutex_unlock(&(split->lock));
+
+    pthread_mutex_destroy(&(split->lock));
+    pthread_cond_destroy(&(split->done));
+
+}
+
+/**
+ * The loop of every thread other than the calling one.
+ */
+static void *_SearchWorker_run(void *argument) {
+
+    _SearchWorker *worker = argument;
+    _SearchPool *pool = worker->pool;
+
+    while (1) {
+
+        _Task task;
+        if (_SearchWorker_take_task(worker, &task)) {
+            _SearchWorker_run_task(worker, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&(pool->lock));
+        while (!pool->is_done && __atomic_load_n(&(pool->tasks_queued), __ATOMIC_RELAXED) == 0) {
+            pthread_cond_wait(&(pool->work_available), &(pool->lock));
+        }
+        int is_done = pool->is_done;
+        pthread_mutex_unlock(&(pool->lock));
+
+        if (is_done) {
+            return NULL;
+        }
+
+    }
+
+}
+
+/**
+ * Starts the threads of a parallel search.
+ * The calling thread becomes worker 0 and runs the given search itself.
+ */
+static _SearchPool *_SearchPool_create(MinMaxSearch *search) {
+
+    _SearchPool *pool = malloc(sizeof(_SearchPool));
+    pool->number_workers = search->options.threads;
+    pool->workers = calloc(pool->number_workers, sizeof(_SearchWorker));
+    pool->threads = malloc(sizeof(pthread_t) * pool->number_workers);
+    pool->tasks_queued = 0;
+    pool->is_done = 0;
+    pool->is_out_of_time = 0;
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->work_available), NULL);
+
+    for (int i = 0; i < pool->number_workers; i++) {
+
+        _SearchWorker *worker = pool->workers + i;
+        worker->id = i;
+        worker->pool = pool;
+        worker->split = NULL;
+        worker->deque.top = 0;
+        worker->deque.bottom = 0;
+        pthread_mutex_init(&(worker->deque.lock), NULL);
+
+        if (i == 0) {
+            worker->search = search;
+        } else {
+            worker->local_search = *search;
+            worker->search = &(worker->local_search);
+            MinMaxSearch_reset_stats(worker->search);
+        }
+
+        worker->search->worker = worker;
+
+    }
+
+    for (int i = 1; i < pool->number_workers; i++) {
+        pthread_create(pool->threads + i, NULL, &_SearchWorker_run, pool->workers + i);
+    }
+
+    return pool;
+
+}
+
+/**
+ * Sets the depth of the current iteration for every thread.
+ * Must only be called while no tasks are queued.
+ */
+static void _SearchPool_set_depth(_SearchPool *pool, int depth) {
+
+    for (int i = 0; i < pool->number_workers; i++) {
+        pool->workers[i].search->depth = depth;
+    }
+
+}
+
+/**
+ * Returns the nodes explored so far by every thread.
+ * Must only be called while no tasks are queued.
+ */
+static long long _SearchPool_nodes_explored(_SearchPool *pool) {
+
+    long long nodes_explored = 0;
+    for (int i = 0; i < pool->number_workers; i++) {
+        nodes_explored += pool->workers[i].search->stats.nodes_explored;
     }
 
+    return nodes_explored;
+
+}
+
+/**
+ * Stops the threads of a parallel search and adds their stats to the calling thread's.
+ */
+static void _SearchPool_delete(_SearchPool *pool) {
+
+    pthread_mutex_lock(&(pool->lock));
+    pool->is_done = 1;
+    pthread_cond_broadcast(&(pool->work_available));
+    pthread_mutex_unlock(&(pool->lock));
+
+    for (int i = 1; i < pool->number_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    MinMaxSearch *search = pool->workers[0].search;
+    for (int i = 1; i < pool->number_workers; i++) {
+
+        MinMaxSearch *other = pool->workers[i].search;
+        search->timed_out |= other->timed_out;
+        search->stats.nodes_generated += other->stats.nodes_generated;
+        search->stats.nodes_explored += other->stats.nodes_explored;
+        search->stats.alpha_cutoffs += other->stats.alpha_cutoffs;
+        search->stats.beta_cutoffs += other->stats.beta_cutoffs;
+        search->stats.pvs_researches += other->stats.pvs_researches;
+        search->stats.nodes_ordered += other->stats.nodes_ordered;
+        search->stats.first_child_best += other->stats.first_child_best;
+        search->stats.table_probes += other->stats.table_probes;
+        search->stats.table_hits += other->stats.table_hits;
+        search->stats.table_collisions += other->stats.table_collisions;
+        search->stats.table_stores += other->stats.table_stores;
+        search->stats.endgame_hits += other->stats.endgame_hits;
+
+        #ifdef SEARCH_STATS
+            for (int ply = 0; ply < MINMAXSEARCH_MAX_STATS_PLY; ply++) {
+
+                MinMaxSearchPlyStats *to = search->stats.plies + ply;
+                MinMaxSearchPlyStats *from = other->stats.plies + ply;
+                to->nodes_generated += from->nodes_generated;
+                to->nodes_explored += from->nodes_explored;
+                to->leaf_nodes += from->leaf_nodes;
+                to->terminal_nodes += from->terminal_nodes;
+                to->dead_states += from->dead_states;
+                to->cutoffs += from->cutoffs;
+                to->table_probes += from->table_probes;
+                to->table_hits += from->table_hits;
+                to->endgame_hits += from->endgame_hits;
+
+            }
+        #endif
+
+    }
+
+    for (int i = 0; i < pool->number_workers; i++) {
+        pthread_mutex_destroy(&(pool->workers[i].deque.lock));
+    }
+
+    search->worker = NULL;
+
+    pthread_mutex_destroy(&(pool->lock));
+    pthread_cond_destroy(&(pool->work_available));
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+
+}
+
+void _MinMaxSearch_merge_split_pv(MinMaxSearch *search, _SplitPoint *split, int ply) {
+
+    if (!split->best_is_task || ply + 1 >= MINMAXSEARCH_MAX_PV) {
+        return;
+    }
+
+    for (int j = ply + 1; j < split->pv_length; j++) {
+        search->pv.moves[ply + 1][j] = split->pv[j];
+    }
+    search->pv.length[ply + 1] = _max(split->pv_length, ply + 1);
+
+    _MinMaxSearch_update_pv(search, ply, split->best_move);
+
+}
+
+/**
+ * Searches every successor of the root once at the current depth.
+ *
+ * The previous iteration's best successor is searched first. Each successor is
+ * searched just below the best utility so far, so that a successor equal to the best
+ * still returns its exact utility and ties can go to the first successor. With PVS,
+ * the successors after the first are only tested against that with a null window.
+ *
+ * Fills in the utility of every successor that was searched in time.
+ */
+static void _MinMaxSearch_search_root(MinMaxSearch *search, _SearchPool *pool, Node *root, int number_successors, int max_player, int window_alpha, int window_beta, int *utilities, int *searched) {
+
+    int indices[MINMAXSEARCH_MAX_MOVES];
+    int order[MINMAXSEARCH_MAX_MOVES];
     for (int i = 0; i < number_successors; i++) {
+        indices[i] = i;
+        order[i] = i;
+        searched[i] = 0;
+    }
+
+    int has_pv = search->pv.previous_length > 0;
+    if (has_pv) {
+        for (int i = search->pv.previous[0]; i > 0; i--) {
+            order[i] = order[i - 1];
+        }
+        order[0] = search->pv.previous[0];
+    }
+
+    search->pv.length[0] = 0;
+
+    int pruning = search->options.alpha_beta_pruning;
+    int alpha = pruning ? window_alpha : -INT_MAX;
+    int beta = pruning ? window_beta : INT_MAX;
+    int best_index = -1;
+
+    for (int k = 0; k < number_successors; k++) {
 
-        int next_depth = depth - 1;
+        int i = order[k];
 
-        int utility = _MinMaxSearch_search_inner(search, root->successors + i, max_player, next_depth, start_time);
-        best_utility = eval_function(best_utility, utility);
+        // With the first successor searched, share the rest with the other threads,
+        // if they fit in the deque. Otherwise the root is searched on alone.
+        if (k > 0 && pool && _Deque_space(&(search->worker->deque)) >= number_successors - k) {
+
+            _SplitPoint split = {
+                .root = root, .moves = indices, .order = order,
+                .is_root = 1, .player = max_player,
+                .depth = search->depth,
+                .alpha = alpha, .beta = beta,
+                .best_utility = best_index >= 0 ? utilities[best_index] : -INT_MAX,
+                .best_move = best_index,
+                .utilities = utilities, .searched = searched
+            };
+            _MinMaxSearch_split(search, &split, k, number_successors);
+            _MinMaxSearch_merge_split_pv(search, &split, 0);
+            break;
+
+        }
+
+        search->pv.is_following = has_pv && k == 0;
+
+        int child_alpha = alpha > -INT_MAX ? alpha - 1 : -INT_MAX;
+        int is_scout = k > 0 && _MinMaxSearch_is_pvs(search);
+        int utility = _MinMaxSearch_search_child_node(search, root->successors + i, max_player, search->depth - 1, child_alpha, beta, is_scout);
+
+        if (_MinMaxSearch_is_stopped(search)) {
+            break;
+        }
+
+        utilities[i] = utility;
+        searched[i] = 1;
+
+        if (best_index < 0 || utility > utilities[best_index] || (utility == utilities[best_index] && i < best_index)) {
+            best_index = i;
+            _MinMaxSearch_update_pv(search, 0, i);
+        }
+
+        // A successor that fails low returns a bound below alpha, leaving it unchanged.
+        // Only an aspiration window ends the root early, as a win found out of order
+        // may still be tied by an earlier successor.
+        if (pruning) {
+            alpha = _max(alpha, utility);
+            if (alpha >= beta && beta < INT_MAX) {
+                break;
+            }
+        }
 
     }
 
-    return best_utility;
+}
+
+/**
+ * Returns the first searched successor with the highest utility, or -1 if none were searched.
+ */
+static inline int _MinMaxSearch_best_root_successor(int number_successors, int *utilities, int *searched) {
+
+    int best_index = -1;
+    for (int i = 0; i < number_successors; i++) {
+        if (searched[i] && (best_index < 0 || utilities[i] > utilities[best_index])) {
+            best_index = i;
+        }
+    }
+
+    return best_index;
+
+}
+
+/**
+ * Searches the root by MTD(f), with null windows from a first guess at its utility
+ * until the bounds they find meet, and then once more just around that utility so
+ * that every successor as good returns it exactly and ties go to the first.
+ *
+ * Fills in the utilities as _MinMaxSearch_search_root does.
+ */
+static void _MinMaxSearch_search_root_mtdf(MinMaxSearch *search, _SearchPool *pool, Node *root, int number_successors, int max_player, int guess, int *utilities, int *searched) {
+
+    int lower = -INT_MAX;
+    int upper = INT_MAX;
+    while (lower < upper) {
+
+        // The root fails high with a utility of at least beta, or low with less.
+        int beta = guess == lower ? guess + 1 : guess;
+        _MinMaxSearch_search_root(search, pool, root, number_successors, max_player, beta - 1, beta, utilities, searched);
+        search->stats.mtdf_passes++;
+
+        int best_index = _MinMaxSearch_best_root_successor(number_successors, utilities, searched);
+        if (_MinMaxSearch_is_stopped(search) || best_index < 0) {
+            return;
+        }
+
+        guess = utilities[best_index];
+        if (guess < beta) {
+            upper = guess;
+        } else {
+            lower = guess;
+        }
+
+    }
+
+    _MinMaxSearch_search_root(search, pool, root, number_successors, max_player, _clamp((long long) guess - 1), _clamp((long long) guess + 1), utilities, searched);
+
+}
+
+/**
+ * Returns the index of the successor of root reached by a move, or -1.
+ */
+static int _MinMaxSearch_find_successor(MinMaxSearch *search, Node *root, int move) {
+
+    for (int i = 0; i < root->number_successors; i++) {
+        if (search->get_move_made(root->successors[i].game_state) == move) {
+            return i;
+        }
+    }
+
+    return -1;
+
+}
+
+int MinMaxSearch_advance(MinMaxSearch *search, Node *root, int move) {
+
+    if (search->get_move_made == NULL) {
+        return 0;
+    }
+
+    int successor = -1;
+    if (root != NULL) {
+        MinMaxSearch_generate_successor_nodes(search, root);
+        successor = _MinMaxSearch_find_successor(search, root, move);
+        if (successor < 0) {
+            return 0;
+        }
+    }
+
+    // The rest of the principal variation is only worth following if the move was on it.
+    int is_on_pv = search->pv.previous_length > 0;
+    if (is_on_pv && search->pv.is_named) {
+        is_on_pv = search->pv.previous[0] == move;
+    } else if (is_on_pv) {
+        is_on_pv = successor >= 0 && search->pv.previous[0] == successor;
+    }
+
+    search->pv.previous_length = is_on_pv ? search->pv.previous_length - 1 : 0;
+    for (int i = 0; i < search->pv.previous_length; i++) {
+        search->pv.previous[i] = search->pv.previous[i + 1];
+    }
+    search->pv.is_named = 1;
+
+    // Killers are kept by ply, and every ply is now one closer to the root.
+    memmove(search->ordering.killers[0], search->ordering.killers[1], sizeof(search->ordering.killers[0]) * (MINMAXSEARCH_MAX_PLY - 1));
+    memset(search->ordering.killers[MINMAXSEARCH_MAX_PLY - 1], 0xff, sizeof(search->ordering.killers[0]));
+
+    // Older history counts for less.
+    for (int player = 0; player < 2; player++) {
+        for (int i = 0; i < MINMAXSEARCH_MAX_MOVES; i++) {
+            search->ordering.history[player][i] >>= 1;
+        }
+    }
+
+    // Each ply moved on leaves one less of the last search's depth below the root.
+    search->carried_depth = (search->is_advanced ? search->carried_depth : search->stats.completed_depth) - 1;
+    search->is_advanced = 1;
+
+    if (root == NULL) {
+        return 1;
+    }
+
+    Node next = root->successors[successor];
+    for (int i = 0; i < root->number_successors; i++) {
+        if (i != successor) {
+            Node_cleanup(root->successors + i, search->free_state);
+        }
+    }
+
+    if (root->game_state) {
+        search->free_state(root->game_state);
+    }
+    _Node_free_successors(root->successors, root->number_successors);
+
+    *root = next;
+
+    return 1;
 
 }
 
 Node *MinMaxSearch_search(MinMaxSearch *search, Node *root) {
 
-    struct timespec start_time, end_time;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &start_time);
+    long long start_ns = _now_ns();
 
     // We must generate the successors of the root node and run our search on it.
     // This assumes we are not at a terminal node.
+    #ifdef SEARCH_STATS
+        long long nodes_generated_before = search->stats.nodes_generated;
+    #endif
     int number_successors = MinMaxSearch_generate_successor_nodes(search, root);
+    _MINMAXSEARCH_PLY_STAT(search, 0, nodes_generated, search->stats.nodes_generated - nodes_generated_before);
 
     int max_player = search->get_turn(root->game_state);
+    search->max_player = max_player;
 
     int max_depth = search->options.max_depth;
 
@@ -140,51 +1122,139 @@ Node *MinMaxSearch_search(MinMaxSearch *search, Node *root) {
     if (search->options.iterative_deepening) {
         starting_depth = search->options.starting_depth;
         depth_step = search->options.depth_step;
+
+        // Carrying on from the last search, the shallower iterations are known already.
+        if (search->is_advanced && search->carried_depth > starting_depth) {
+            starting_depth = _min(search->carried_depth, max_depth);
+        }
+    }
+
+    // The clock is only read every so many nodes, against a fixed deadline.
+    search->timed_out = 0;
+    search->deadline_ns = 0;
+    search->time_check_countdown = MINMAXSEARCH_TIME_CHECK_INTERVAL;
+    if (search->options.time_limit_in_ms >= 0) {
+        search->deadline_ns = start_ns + search->options.time_limit_in_ms * 1000000LL;
+    }
+
+    // Forget the move ordering learnt in previous searches, unless this search was
+    // moved on from the last one. Its principal variation then starts with a move
+    // that must be found among the successors.
+    if (!search->is_advanced) {
+        memset(search->ordering.killers, 0xff, sizeof(search->ordering.killers));
+        memset(search->ordering.history, 0, sizeof(search->ordering.history));
+        search->pv.previous_length = 0;
+    } else if (search->pv.is_named && search->pv.previous_length > 0) {
+        int successor = _MinMaxSearch_find_successor(search, root, search->pv.previous[0]);
+        search->pv.previous[0] = successor;
+        search->pv.previous_length = successor >= 0 ? search->pv.previous_length : 0;
+    }
+    search->is_advanced = 0;
+    search->pv.is_named = 0;
+
+    // Start the other threads of a parallel search.
+    _SearchPool *pool = NULL;
+    if (search->options.threads > 1) {
+        pool = _SearchPool_create(search);
     }
 
     int index_of_highest_utility = 0;
-    int highest_utility = INT_MIN;
+    int highest_utility = -INT_MAX;
+    int has_completed = 0;
     for (int current_search_depth = starting_depth; current_search_depth <= max_depth; current_search_depth += depth_step) {
 
         search->depth = current_search_depth;
+        if (pool) {
+            _SearchPool_set_depth(pool, current_search_depth);
+        }
 
-        // Return the node that had the highest utility.
-        int is_time_left = 1;
-        for (int i = 0; i < number_successors; i++) {
+        long long iteration_start_ns = _now_ns();
+        long long iteration_start_nodes = pool ? _SearchPool_nodes_explored(pool) : search->stats.nodes_explored;
 
-            int next_depth = search->depth - 1;
+        // Expect the utility to stay close to the previous iteration's.
+        int window_alpha = -INT_MAX;
+        int window_beta = INT_MAX;
+        int window = search->options.aspiration_window;
+        if (has_completed && window > 0) {
+            window_alpha = _clamp((long long) highest_utility - window);
+            window_beta = _clamp((long long) highest_utility + window);
+        }
 
-            int utility = _MinMaxSearch_search_inner(search, root->successors + i, max_player, next_depth, start_time);
+        int utilities[MINMAXSEARCH_MAX_MOVES];
+        int searched[MINMAXSEARCH_MAX_MOVES];
+        int best_index;
+        int is_mtdf = search->options.alpha_beta_pruning && search->options.algorithm == MINMAXSEARCH_MTDF;
+        if (is_mtdf) {
+            _MinMaxSearch_search_root_mtdf(search, pool, root, number_successors, max_player, has_completed ? highest_utility : 0, utilities, searched);
+            best_index = _MinMaxSearch_best_root_successor(number_successors, utilities, searched);
+        }
+
+        while (!is_mtdf) {
+
+            _MinMaxSearch_search_root(search, pool, root, number_successors, max_player, window_alpha, window_beta, utilities, searched);
+            best_index = _MinMaxSearch_best_root_successor(number_successors, utilities, searched);
 
-            if (utility > highest_utility) {
-                highest_utility = utility;
-                index_of_highest_utility = i;
+            if (_MinMaxSearch_is_stopped(search) || best_index < 0 || !search->options.alpha_beta_pruning) {
+                break;
             }
 
+            // Outside of the window the utility is only a bound, so search again in full.
+            int fails_low = window_alpha > -INT_MAX && utilities[best_index] < window_alpha;
+            int fails_high = window_beta < INT_MAX && utilities[best_index] >= window_beta;
+            if (!fails_low && !fails_high) {
+                break;
+            }
+
+            search->stats.aspiration_researches++;
+            window_alpha = -INT_MAX;
+            window_beta = INT_MAX;
+
         }
 
-        if (!is_time_left) {
+        if (_MinMaxSearch_is_stopped(search)) {
+
+            // An iteration cut short can not be trusted, unless it is all we have.
+            if (!has_completed && best_index >= 0) {
+                index_of_highest_utility = best_index;
+                highest_utility = utilities[best_index];
+            }
+
             break;
+
         }
 
-    }
+        index_of_highest_utility = best_index;
+        highest_utility = utilities[best_index];
+        has_completed = 1;
+
+        // Keep this iteration's principal variation to lead the next one.
+        search->pv.previous_length = search->pv.length[0];
+        for (int j = 0; j < search->pv.length[0]; j++) {
+            search->pv.previous[j] = search->pv.moves[0][j];
+        }
 
-    clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+        search->stats.completed_depth = current_search_depth;
+        if (search->stats.iterations < MINMAXSEARCH_MAX_PV) {
+            search->stats.iteration_time_us[search->stats.iterations] = (_now_ns() - iteration_start_ns) / 1000;
+            search->stats.iteration_depth[search->stats.iterations] = current_search_depth;
+            search->stats.iteration_nodes[search->stats.iterations] =
+                (pool ? _SearchPool_nodes_explored(pool) : search->stats.nodes_explored) - iteration_start_nodes;
+        }
+        search->stats.iterations++;
 
-    // Calculate the time taken.
-    long difference_s = end_time.tv_sec - start_time.tv_sec;
-    long difference_ns = end_time.tv_nsec - start_time.tv_nsec;
+    }
 
-    if (difference_ns < 0) {
-        difference_s -= 1;
-        difference_ns += 1000000000;
+    if (pool) {
+        _SearchPool_delete(pool);
     }
 
-    search->stats.elapsed_time_ms = difference_s * 1000 + (difference_ns / 1000000);
-    search->stats.elapsed_time_us = difference_s * 1000000 + (difference_ns / 1000);
-    search->stats.elapsed_time_us -= search->stats.elapsed_time_ms * 1000;
+    // Calculate the time taken.
+    long long elapsed_us = (_now_ns() - start_ns) / 1000;
+    search->stats.elapsed_time_ms = elapsed_us / 1000;
+    search->stats.elapsed_time_us = elapsed_us % 1000;
 
     // Return the best successor node.
+    search->best_utility = highest_utility;
     return root->successors + index_of_highest_utility;
 
 }
@@ -202,7 +1272,7 @@ int MinMaxSearch_generate_successor_nodes(MinMaxSearch *search, Node *root) {
     // The node is not terminal, so there must be at least one successor.
     // We will turn these successors into proper nodes.
     root->number_successors = number_successors;
-    root->successors = malloc(sizeof(Node) * number_successors);
+    root->successors = _Node_allocate_successors(number_successors);
     for (int i = 0; i < number_successors; i++) {
 
         root->successors[i].game_state = successors[i];
@@ -225,7 +1295,25 @@ void MinMaxSearch_reset_stats(MinMaxSearch *search) {
 
     search->stats.nodes_generated = 0;
     search->stats.nodes_explored = 0;
+    search->stats.alpha_cutoffs = 0;
+    search->stats.beta_cutoffs = 0;
+    search->stats.nodes_ordered = 0;
+    search->stats.first_child_best = 0;
+    search->stats.table_probes = 0;
+    search->stats.table_hits = 0;
+    search->stats.table_collisions = 0;
+    search->stats.table_stores = 0;
+    search->stats.endgame_hits = 0;
+    search->stats.completed_depth = 0;
+    search->stats.iterations = 0;
+    search->stats.aspiration_researches = 0;
+    search->stats.pvs_researches = 0;
+    search->stats.mtdf_passes = 0;
     search->stats.elapsed_time_ms = 0;
     search->stats.elapsed_time_us = 0;
 
+    #ifdef SEARCH_STATS
+        memset(search->stats.plies, 0, sizeof(search->stats.plies));
+    #endif
+
 }
\ No newline at end of file
@@ -1,4 +1,41 @@
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "transposition.h"
+
+// The most moves any state may have when searching in place.
+#define MINMAXSEARCH_MAX_MOVES 32
+
+// The deepest ply that killer moves are kept for.
+#define MINMAXSEARCH_MAX_PLY 128
+
+// The most tasks a single thread may have waiting in a parallel search.
+#define MINMAXSEARCH_MAX_TASKS 256
+
+// The largest undo record a game may use when searching in place.
+#define MINMAXSEARCH_MAX_UNDO_SIZE 64
+
+// The longest principal variation kept, and the most iterations timed.
+#define MINMAXSEARCH_MAX_PV 64
+
+// The most plies stats are broken down for with SEARCH_STATS. Deeper plies count towards the last.
+#define MINMAXSEARCH_MAX_STATS_PLY 64
+
+// The formats stats can be written in.
+#define MINMAXSEARCH_STATS_TEXT 0
+#define MINMAXSEARCH_STATS_JSON 1
+#define MINMAXSEARCH_STATS_CSV 2
+
+// How many nodes are searched between reads of the clock.
+#define MINMAXSEARCH_TIME_CHECK_INTERVAL 1024
+
+// The algorithms a search may use, see options.algorithm.
+#define MINMAXSEARCH_ALPHA_BETA 0
+#define MINMAXSEARCH_PVS 1
+#define MINMAXSEARCH_MTDF 2
+
 typedef struct _Node {
 
     void *game_state;
@@ -13,8 +50,36 @@ typedef struct _Node {
  */
 void Node_cleanup(Node *node, void (*free_state) (void *state));
 
+#ifdef POOL
+    /**
+     * Prints the statistics of the pool successor arrays are allocated from.
+     */
+    void Node_print_pool();
+#endif
+
+/**
+ * The stats of a single ply of the search, only kept when compiled with SEARCH_STATS.
+ * The root is at ply 0, and the counts of every ply add up to the totals of the search.
+ */
 typedef struct {
 
+    long long nodes_generated; // Children of the nodes at this ply.
+    long long nodes_explored;
+    long long leaf_nodes; // Nodes at the depth of the search, evaluated as they are.
+    long long terminal_nodes; // Nodes where the game is over.
+    long long dead_states; // Nodes pruned as dead states.
+    long long cutoffs; // Nodes abandoned once the window closed.
+    long long table_probes;
+    long long table_hits;
+    long long endgame_hits;
+
+} MinMaxSearchPlyStats;
+
+// A thread taking part in a parallel search, see gametree.c.
+struct _SearchWorker;
+
+typedef struct _MinMaxSearch {
+
     // Search options.
     // ---------------
     struct {
@@ -28,15 +93,71 @@ typedef struct {
         int depth_step;
         int time_limit_in_ms; // If negative, there is no limit.
 
+        // Searches each iteration after the first within this distance of the last
+        // iteration's utility, searching again in full if the result falls outside.
+        // 0 searches every iteration with a full window.
+        int aspiration_window;
+
         // Enables pruning techniques.
         int dead_state_pruning;
         int alpha_beta_pruning;
 
+        // The algorithm searching each iteration when alpha_beta_pruning is enabled,
+        // all of which find the same move and utility as a search without pruning.
+        //  - MINMAXSEARCH_ALPHA_BETA searches every child with the full window.
+        //  - MINMAXSEARCH_PVS (principal variation search) searches the first child with
+        //    the full window and only tests the rest against it with a null window,
+        //    searching a child again in full when it turns out to be better.
+        //  - MINMAXSEARCH_MTDF searches the root with a null window again and again,
+        //    starting from the last iteration's utility, until the bounds found meet.
+        //    It relies on the transposition table to keep each pass cheap, and takes
+        //    the place of the aspiration window. Without a table it still finds the
+        //    same move and utility, but every pass searches afresh, often costing two
+        //    to four times the nodes of alpha beta.
+        int algorithm;
+
+        // Enables move ordering techniques.
+        // Each reorders the children of a node before they are searched.
+        int order_static; // Uses the game's move_hint.
+        int order_killers; // Tries moves that caused cutoffs at the same ply first.
+        int order_history; // Tries moves that caused cutoffs anywhere first.
+
+        // Frees the successors of every node below the root as soon as the node has
+        // been searched, so only the current path and the root's successors are kept.
+        // Memory then grows with depth times branching instead of with the nodes
+        // explored. Searching in place never keeps these nodes to begin with.
+        int streaming;
+
+        // Enables and modifies the parallel search.
+        // Once the first child of a node has been searched, the remaining children
+        // may be handed to idle threads (Young Brothers Wait). Only nodes with at
+        // least split_depth plies left below them are split.
+        int threads; // 1 or less searches on the calling thread only.
+        int split_depth;
+
     } options;
 
     int depth;
 
+    // The player to play at the root of the current search.
+    int max_player;
+
+    // The utility of the successor returned by the last search, for the player to play.
+    int best_utility;
+
+    // Set when a search ran out of time, so its results can not be trusted.
+    int timed_out;
+
+    // When the search must stop, 0 if never, and the nodes left until the clock is read.
+    long long deadline_ns;
+    int time_check_countdown;
+
+    // Optional flag another thread may set to stop the search as if it ran out of
+    // time. It is read along with the clock.
+    int *stop;
+
     // Game functions.
+    // Utilities must lie between -INT_MAX and INT_MAX, so that they can be negated.
     int (*utility) (void *state, int for_player);
     int (*is_terminal) (void *state);
     int (*get_turn) (void *state);
@@ -44,22 +165,111 @@ typedef struct {
     void (*free_state) (void *state);
     int (*is_dead_state) (void *state, int for_player);
 
+    // Optional in-place game functions.
+    // When all of these are set, the search walks a single mutable state down and
+    // back up the tree instead of copying a new state for every node.
+    // Only the successors of the root are created as nodes.
+    int (*get_moves) (void *state, int *moves);
+    void (*make_move) (void *state, int move, void *undo);
+    void (*unmake_move) (void *state, void *undo);
+    size_t undo_size;
+
+    // Optional move ordering functions.
+    // get_move_made names the move that produced a state, so that nodes can be ordered
+    // by killer and history tables. move_hint returns a static estimate of how good a
+    // move is from the given state, higher being better.
+    int (*get_move_made) (void *state);
+    int (*move_hint) (void *state, int move);
+
+    // Optional copy function.
+    // Searching in place, nodes below the root can only be split between threads
+    // when their state can be copied.
+    // With more than one thread, every game function must be safe to call from
+    // several threads on different states.
+    void *(*copy_state) (void *state);
+
+    // Optional transposition table.
+    // When both are set, every interior node is looked up by its hash before its
+    // successors are generated. The table is owned by the caller and may be kept
+    // between searches.
+    uint64_t (*hash) (void *state);
+    TranspositionTable *transposition_table;
+
+    // Optional endgame database.
+    // Returns 1 and sets utility to the exact utility of a state for the given player
+    // if the game knows it without searching, or returns 0. Such states are never
+    // searched below, wherever they appear in the tree.
+    int (*endgame_utility) (void *state, int for_player, int *utility);
+
+    // Optional search of every node below the root, instantiated for a particular
+    // game from gametree_search.h to call its functions directly. The function
+    // pointers above must still all be set, as the search around it uses them.
+    int (*search_node) (struct _MinMaxSearch *search, Node *root, int player, int depth, int alpha, int beta);
+
+    // The thread running this search, NULL when searching on a single thread.
+    struct _SearchWorker *worker;
+
+    // Move ordering tables, reset at the start of each search.
+    struct {
+        int killers[MINMAXSEARCH_MAX_PLY][2];
+        unsigned int history[2][MINMAXSEARCH_MAX_MOVES];
+    } ordering;
+
+    // Principal variation, as indices into each state's successors or moves.
+    // moves[ply] holds the best line found below the node at that ply. The line from
+    // the last completed iteration is followed first by the next one.
+    struct {
+        int moves[MINMAXSEARCH_MAX_PV][MINMAXSEARCH_MAX_PV];
+        int length[MINMAXSEARCH_MAX_PV];
+        int previous[MINMAXSEARCH_MAX_PV];
+        int previous_length;
+        int is_following;
+        int is_named; // previous[0] names a move, as left by MinMaxSearch_advance, rather than indexing the root's successors.
+    } pv;
+
+    // Set by MinMaxSearch_advance, so the next search keeps what the last one learnt.
+    int is_advanced;
+    int carried_depth; // The depth the last search completed, less the plies moved on since.
+
     // Stats.
     struct {
-        int nodes_generated;
-        int nodes_explored;
-        int elapsed_time_ms;
-        int elapsed_time_us;
+        long long nodes_generated;
+        long long nodes_explored;
+        long long alpha_cutoffs; // Nodes of the other player abandoned because utility fell below alpha.
+        long long beta_cutoffs; // Nodes of the player at the root abandoned because utility rose above beta.
+        long long pvs_researches; // Children searched again in full after a null window showed them better.
+        int mtdf_passes; // Null window searches of the root by MTD(f), over every iteration.
+        long long nodes_ordered; // Nodes whose children were searched.
+        long long first_child_best; // Nodes whose first searched child was the best.
+        long long table_probes; // Transposition table lookups.
+        long long table_hits; // Lookups that found an entry for the same state.
+        long long table_collisions; // Lookups that found an entry for another state.
+        long long table_stores; // Entries written to the transposition table.
+        long long endgame_hits; // States whose exact utility came from the endgame database.
+        int completed_depth; // Depth of the last iteration to finish in time.
+        int iterations; // Iterations finished in time.
+        int aspiration_researches; // Iterations searched again after leaving the window.
+        int iteration_depth[MINMAXSEARCH_MAX_PV];
+        long long iteration_time_us[MINMAXSEARCH_MAX_PV];
+        long long iteration_nodes[MINMAXSEARCH_MAX_PV]; // Nodes explored by every thread in the iteration.
+        long long elapsed_time_ms;
+        long long elapsed_time_us;
+        #ifdef SEARCH_STATS
+            MinMaxSearchPlyStats plies[MINMAXSEARCH_MAX_STATS_PLY];
+        #endif
     } stats;
 
 } MinMaxSearch;
 
 /**
- * Prints the statistics from the last search.
+ * Writes the statistics from the last search to a file, as MINMAXSEARCH_STATS_TEXT
+ * for people to read, as a single MINMAXSEARCH_STATS_JSON object, or as
+ * MINMAXSEARCH_STATS_CSV with a row for the totals, each iteration and each ply.
  *
+ * The breakdown per ply is only included when compiled with SEARCH_STATS.
  * Be sure to clear the stats using _reset_stats before running a new search.
  */
-void MinMaxSearch_print_stats(MinMaxSearch *search);
+void MinMaxSearch_write_stats(MinMaxSearch *search, FILE *file, int format);
 
 /**
  * Returns the successor node of root that will yield the maximal return.
@@ -67,6 +277,21 @@ void MinMaxSearch_print_stats(MinMaxSearch *search);
  */
 Node *MinMaxSearch_search(MinMaxSearch *search, Node *root);
 
+/**
+ * Moves the search on by a move played from the root of its last search, so that the
+ * next search, from the position the move leads to, starts with the move ordering
+ * and the rest of the principal variation learnt by the last. Deepening iteratively,
+ * it also starts from the depth the last completed, less the plies moved on by.
+ * Moves are named the way get_move_made names them, which must be set.
+ *
+ * If root is given, it becomes the successor reached by the move, keeping everything
+ * already generated below it. Its siblings are freed, and so is the old root's state
+ * unless it is NULL. Otherwise only the ordering and principal variation move on.
+ *
+ * Returns 0 if the move could not be followed, leaving the search as it was.
+ */
+int MinMaxSearch_advance(MinMaxSearch *search, Node *root, int move);
+
 /**
  * Generates the successors for the root node.
  * Returns the number of successors.
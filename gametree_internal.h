@@ -0,0 +1,308 @@
+/**
+ *
+ * This file holds the internals of the search shared between gametree.c and the
+ * searches specialized for particular games (see gametree_search.h).
+ *
+ * It describes the threads of a parallel search and the helpers every instance of
+ * the search uses that never call the game. Include it after gametree.h, and only
+ * from the files implementing the search.
+ *
+ */
+
+
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <time.h>
+
+static inline int _max(int a, int b) {
+    if (a > b) {
+        return a;
+    }
+    return b;
+}
+
+static inline int _min(int a, int b) {
+    if (a < b) {
+        return a;
+    }
+    return b;
+}
+
+/**
+ * Adds to a counter in the stats of a ply. Compiled out without SEARCH_STATS.
+ */
+#ifdef SEARCH_STATS
+    #define _MINMAXSEARCH_PLY_STAT(search, ply, counter, amount) \
+        ((search)->stats.plies[_min((ply), MINMAXSEARCH_MAX_STATS_PLY - 1)].counter += (amount))
+#else
+    #define _MINMAXSEARCH_PLY_STAT(search, ply, counter, amount) ((void) 0)
+#endif
+
+/**
+ * Returns the current time in nanoseconds from an arbitrary starting point.
+ */
+static inline long long _now_ns() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+
+}
+
+/**
+ * Checks if the game functions for searching in place are provided.
+ */
+static inline int _MinMaxSearch_is_in_place(MinMaxSearch *search) {
+
+    return search->get_moves && search->make_move && search->unmake_move
+        && search->undo_size <= MINMAXSEARCH_MAX_UNDO_SIZE;
+
+}
+
+// Parallel search.
+// ----------------
+//
+// Every thread owns a worker with its own copy of the search, so stats and move
+// ordering tables are never shared, and a deque of tasks. A task is a single child
+// of a split point. A thread pushes and pops tasks at the bottom of its own deque,
+// while idle threads steal from the top of others' deques.
+
+/**
+ * A node whose remaining children are being searched by several threads.
+ * Its window and utilities are for the player to play at the node.
+ * All fields below the lock may only be touched while holding it.
+ */
+typedef struct _SplitPoint {
+
+    // The split point this node lies under, if any.
+    struct _SplitPoint *parent;
+
+    Node *root;
+    int *moves;
+    int *order;
+    int is_root;
+    int player;
+    int depth;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+
+    int alpha;
+    int beta;
+    int best_utility;
+    int best_move;
+    int best_ordered_child;
+
+    // Set once the window closes, so remaining children are abandoned.
+    int cutoff;
+
+    // Children not yet finished.
+    int tasks_left;
+
+    // The principal variation below the best child, when it was searched as a task.
+    int best_is_task;
+    int pv[MINMAXSEARCH_MAX_PV];
+    int pv_length;
+
+    // The utility of each child of the root and whether it finished in time.
+    int *utilities;
+    int *searched;
+
+} _SplitPoint;
+
+typedef struct {
+
+    _SplitPoint *split;
+    int ordered_child;
+
+} _Task;
+
+typedef struct {
+
+    pthread_mutex_t lock;
+    _Task tasks[MINMAXSEARCH_MAX_TASKS];
+    int top;
+    int bottom;
+
+} _Deque;
+
+typedef struct _SearchPool {
+
+    int number_workers;
+    struct _SearchWorker *workers;
+    pthread_t *threads;
+
+    // Idle threads sleep until tasks are queued or the search is over.
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    int tasks_queued;
+    int is_done;
+
+    // Set by the first thread to notice the time limit, stopping all of them.
+    int is_out_of_time;
+
+} _SearchPool;
+
+typedef struct _SearchWorker {
+
+    int id;
+    _SearchPool *pool;
+
+    // The search this thread runs, owned by the worker for all but the calling thread.
+    MinMaxSearch *search;
+    MinMaxSearch local_search;
+
+    // The innermost split point this thread is working under.
+    _SplitPoint *split;
+
+    _Deque deque;
+
+} _SearchWorker;
+
+/**
+ * Checks if a cutoff above the current node means its result is no longer needed.
+ */
+static inline int _SplitPoint_is_abandoned(_SplitPoint *split) {
+
+    for (; split != NULL; split = split->parent) {
+        if (__atomic_load_n(&(split->cutoff), __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+
+    return 0;
+
+}
+
+/**
+ * Checks the clock and the stop flag every MINMAXSEARCH_TIME_CHECK_INTERVAL nodes and
+ * marks the search (and every other thread) as out of time once the deadline has
+ * passed or the flag is set.
+ */
+static inline void _MinMaxSearch_poll_time(MinMaxSearch *search) {
+
+    if ((search->deadline_ns == 0 && search->stop == NULL) || --(search->time_check_countdown) > 0) {
+        return;
+    }
+
+    search->time_check_countdown = MINMAXSEARCH_TIME_CHECK_INTERVAL;
+
+    int is_stopped = search->stop != NULL && __atomic_load_n(search->stop, __ATOMIC_RELAXED);
+    int is_late = search->deadline_ns != 0 && _now_ns() >= search->deadline_ns;
+    if (is_stopped || is_late) {
+
+        search->timed_out = 1;
+        if (search->worker) {
+            __atomic_store_n(&(search->worker->pool->is_out_of_time), 1, __ATOMIC_RELAXED);
+        }
+
+    }
+
+}
+
+/**
+ * Checks if the result of the current node is no longer needed, either because the
+ * search is out of time or because another thread made it pointless.
+ */
+static inline int _MinMaxSearch_is_stopped(MinMaxSearch *search) {
+
+    if (search->timed_out) {
+        return 1;
+    }
+
+    if (search->worker == NULL) {
+        return 0;
+    }
+
+    if (__atomic_load_n(&(search->worker->pool->is_out_of_time), __ATOMIC_RELAXED)) {
+        search->timed_out = 1;
+        return 1;
+    }
+
+    return _SplitPoint_is_abandoned(search->worker->split);
+
+}
+
+static inline int _Deque_space(_Deque *deque) {
+
+    pthread_mutex_lock(&(deque->lock));
+    int space = MINMAXSEARCH_MAX_TASKS - deque->bottom;
+    pthread_mutex_unlock(&(deque->lock));
+
+    return space;
+
+}
+
+/**
+ * Checks if the remaining children of a node should be shared with other threads.
+ */
+static inline int _MinMaxSearch_should_split(MinMaxSearch *search, int depth, int children_left) {
+
+    if (search->worker == NULL || children_left < 1) {
+        return 0;
+    }
+
+    // In place, states below the root must be copied for other threads.
+    if (_MinMaxSearch_is_in_place(search) && search->copy_state == NULL) {
+        return 0;
+    }
+
+    return depth >= search->options.split_depth && _Deque_space(&(search->worker->deque)) >= children_left;
+
+}
+
+/**
+ * Remembers a move that caused a cutoff so it is tried early in similar positions.
+ */
+static inline void _MinMaxSearch_record_cutoff(MinMaxSearch *search, int player, int move, int ply, int depth) {
+
+    if (ply < MINMAXSEARCH_MAX_PLY && search->ordering.killers[ply][0] != move) {
+        search->ordering.killers[ply][1] = search->ordering.killers[ply][0];
+        search->ordering.killers[ply][0] = move;
+    }
+
+    if (move >= 0 && move < MINMAXSEARCH_MAX_MOVES) {
+        search->ordering.history[player][move] += depth * depth;
+    }
+
+}
+
+/**
+ * Makes the given move followed by the principal variation of the next ply the
+ * principal variation of this ply.
+ */
+static inline void _MinMaxSearch_update_pv(MinMaxSearch *search, int ply, int move) {
+
+    if (ply >= MINMAXSEARCH_MAX_PV) {
+        return;
+    }
+
+    search->pv.moves[ply][ply] = move;
+    search->pv.length[ply] = ply + 1;
+
+    if (ply + 1 < MINMAXSEARCH_MAX_PV) {
+        for (int j = ply + 1; j < search->pv.length[ply + 1]; j++) {
+            search->pv.moves[ply][j] = search->pv.moves[ply + 1][j];
+        }
+        search->pv.length[ply] = _max(search->pv.length[ply + 1], ply + 1);
+    }
+
+}
+
+/**
+ * Searches the children of a split point from first_child onwards across all threads.
+ * The calling thread works through its own tasks and then waits for the rest.
+ */
+void _MinMaxSearch_split(MinMaxSearch *search, _SplitPoint *split, int first_child, int number_successors);
+
+/**
+ * Adopts the principal variation of a split point's best child, if another thread found it.
+ */
+void _MinMaxSearch_merge_split_pv(MinMaxSearch *search, _SplitPoint *split, int ply);
+
+/**
+ * Frees the successors of a node and everything below them.
+ * The node may be expanded again later.
+ */
+void _MinMaxSearch_discard_successors(MinMaxSearch *search, Node *root);
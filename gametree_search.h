@@ -0,0 +1,429 @@
+/**
+ *
+ * This file is a template of the search below the root, instantiated once for
+ * every way of calling the game.
+ *
+ * gametree.c instantiates it to call the game through the function pointers of the
+ * search. A game may instantiate it again with direct calls to its own functions,
+ * which the compiler can then inline, and set the search's search_node to the result.
+ *
+ * Include it after gametree.h and gametree_internal.h, with these defined:
+ *
+ *  - MINMAXSEARCH_NAME(name), naming every function of this instance.
+ *  - MINMAXSEARCH_IS_IN_PLACE(search), whether the state is searched in place.
+ *  - MINMAXSEARCH_UTILITY(search, state, for_player), MINMAXSEARCH_IS_TERMINAL(search, state),
+ *    MINMAXSEARCH_GET_TURN(search, state), MINMAXSEARCH_IS_DEAD_STATE(search, state, for_player),
+ *    MINMAXSEARCH_GET_MOVES(search, state, moves), MINMAXSEARCH_MAKE_MOVE(search, state, move, undo),
+ *    MINMAXSEARCH_UNMAKE_MOVE(search, state, undo), MINMAXSEARCH_MOVE_HINT(search, state, move)
+ *    and MINMAXSEARCH_HASH(search, state), standing in for the game functions of the
+ *    same names. The optional ones are still only called when their pointers are set.
+ *
+ * The search of a node is then MINMAXSEARCH_NAME(_MinMaxSearch_search_inner), which takes
+ * and returns utilities for the given player like MinMaxSearch.search_node.
+ * MINMAXSEARCH_NAME is undefined at the end, the rest are left for the next instance.
+ *
+ */
+
+/**
+ * Finds the children of a node.
+ * When searching in place only the moves are listed, otherwise successor nodes are generated.
+ * Returns the number of children.
+ */
+static inline int MINMAXSEARCH_NAME(_MinMaxSearch_expand)(MinMaxSearch *search, Node *root, int *moves) {
+
+    if (MINMAXSEARCH_IS_IN_PLACE(search)) {
+
+        int number_moves = MINMAXSEARCH_GET_MOVES(search, root->game_state, moves);
+        search->stats.nodes_generated += number_moves;
+        return number_moves;
+
+    }
+
+    int number_successors = MinMaxSearch_generate_successor_nodes(search, root);
+
+    // Name the successors by the move that made them so they can be ordered.
+    for (int i = 0; i < number_successors; i++) {
+        if (search->get_move_made) {
+            moves[i] = search->get_move_made(root->successors[i].game_state);
+        } else {
+            moves[i] = i;
+        }
+    }
+
+    return number_successors;
+
+}
+
+/**
+ * Scores a single move for ordering, higher scores are searched first.
+ *
+ * The move on the previous principal variation comes first, then the best move from
+ * the transposition table, then the static hint from the game, then killer moves,
+ * then the history table.
+ */
+static inline long long MINMAXSEARCH_NAME(_MinMaxSearch_move_score)(MinMaxSearch *search, Node *root, int player, int move, int ply, int table_move, int pv_move) {
+
+    long long score = 0;
+
+    // The previous iteration's principal variation and then the best move found by an
+    // earlier search of this state come before anything else.
+    if (move == pv_move) {
+        score += 1LL << 62;
+    }
+    if (move == table_move) {
+        score += 1LL << 61;
+    }
+
+    if (search->options.order_static && search->move_hint) {
+        score += (long long) MINMAXSEARCH_MOVE_HINT(search, root->game_state, move) << 40;
+    }
+
+    if (search->options.order_killers && ply < MINMAXSEARCH_MAX_PLY) {
+        if (search->ordering.killers[ply][0] == move) {
+            score += 2LL << 32;
+        } else if (search->ordering.killers[ply][1] == move) {
+            score += 1LL << 32;
+        }
+    }
+
+    if (search->options.order_history && move >= 0 && move < MINMAXSEARCH_MAX_MOVES) {
+        score += search->ordering.history[player][move];
+    }
+
+    return score;
+
+}
+
+/**
+ * Fills order with the indices of the children in the order they should be searched.
+ * Children with equal scores keep their original order.
+ */
+static inline void MINMAXSEARCH_NAME(_MinMaxSearch_order_children)(MinMaxSearch *search, Node *root, int number_successors, int *moves, int ply, int table_move, int pv_move, int *order) {
+
+    for (int i = 0; i < number_successors; i++) {
+        order[i] = i;
+    }
+
+    int is_ordering = search->options.order_static || search->options.order_killers || search->options.order_history;
+    if (!is_ordering && table_move < 0 && pv_move < 0) {
+        return;
+    }
+
+    int player = MINMAXSEARCH_GET_TURN(search, root->game_state);
+
+    long long scores[MINMAXSEARCH_MAX_MOVES];
+    for (int i = 0; i < number_successors; i++) {
+        scores[i] = MINMAXSEARCH_NAME(_MinMaxSearch_move_score)(search, root, player, moves[i], ply, table_move, pv_move);
+    }
+
+    // There are only a handful of children, so a stable insertion sort does well.
+    for (int i = 1; i < number_successors; i++) {
+
+        int child = order[i];
+        int j = i - 1;
+        while (j >= 0 && scores[order[j]] < scores[child]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = child;
+
+    }
+
+}
+
+/**
+ * Returns the node for the given child, playing its move if searching in place.
+ * Every call must be matched by a call to `_MinMaxSearch_leave_child`.
+ */
+static inline Node *MINMAXSEARCH_NAME(_MinMaxSearch_enter_child)(MinMaxSearch *search, Node *root, int child, int *moves, void *undo) {
+
+    if (MINMAXSEARCH_IS_IN_PLACE(search)) {
+        MINMAXSEARCH_MAKE_MOVE(search, root->game_state, moves[child], undo);
+        return root;
+    }
+
+    return root->successors + child;
+
+}
+
+static inline void MINMAXSEARCH_NAME(_MinMaxSearch_leave_child)(MinMaxSearch *search, Node *root, void *undo) {
+
+    if (MINMAXSEARCH_IS_IN_PLACE(search)) {
+        MINMAXSEARCH_UNMAKE_MOVE(search, root->game_state, undo);
+    }
+
+}
+
+static int MINMAXSEARCH_NAME(_MinMaxSearch_negamax)(MinMaxSearch *search, Node *root, int turn, int depth, int alpha, int beta);
+
+/**
+ * The inner search function which returns utility values instead of nodes.
+ *
+ * Returns the utility of a node for the given player, within the window (alpha, beta)
+ * of that player. Each node is searched by negamax for the player to play there, so
+ * the utility and window are turned around whenever the turn has passed.
+ */
+static inline int MINMAXSEARCH_NAME(_MinMaxSearch_search_inner)(MinMaxSearch *search, Node *root, int player, int depth, int alpha, int beta) {
+
+    int turn = MINMAXSEARCH_GET_TURN(search, root->game_state);
+    if (turn == player) {
+        return MINMAXSEARCH_NAME(_MinMaxSearch_negamax)(search, root, turn, depth, alpha, beta);
+    }
+
+    return -MINMAXSEARCH_NAME(_MinMaxSearch_negamax)(search, root, turn, depth, -beta, -alpha);
+
+}
+
+/**
+ * Searches a child for the player to play at its parent.
+ *
+ * A scout only tests the child with a null window just above alpha, as PVS does for
+ * every child after the first. Only a child that may lie inside the window is
+ * searched again in full.
+ */
+static inline int MINMAXSEARCH_NAME(_MinMaxSearch_search_child)(MinMaxSearch *search, Node *child, int player, int depth, int alpha, int beta, int is_scout) {
+
+    if (!is_scout || alpha + 1 >= beta) {
+        return MINMAXSEARCH_NAME(_MinMaxSearch_search_inner)(search, child, player, depth, alpha, beta);
+    }
+
+    int utility = MINMAXSEARCH_NAME(_MinMaxSearch_search_inner)(search, child, player, depth, alpha, alpha + 1);
+    if (utility > alpha && utility < beta && !_MinMaxSearch_is_stopped(search)) {
+        search->stats.pvs_researches++;
+        utility = MINMAXSEARCH_NAME(_MinMaxSearch_search_inner)(search, child, player, depth, alpha, beta);
+    }
+
+    return utility;
+
+}
+
+/**
+ * Searches a node for the player to play there.
+ *
+ * With alpha beta pruning enabled, the search stops exploring a node as soon as
+ * its utility rises above beta. The returned utility is then only a bound on the
+ * true utility, but may lie outside of the window (fail-soft).
+ */
+static int MINMAXSEARCH_NAME(_MinMaxSearch_negamax)(MinMaxSearch *search, Node *root, int turn, int depth, int alpha, int beta) {
+
+    // Start with an empty principal variation at this ply.
+    int ply = search->depth - depth;
+    if (ply < MINMAXSEARCH_MAX_PV) {
+        search->pv.length[ply] = ply;
+    }
+
+    // Give up straight away if we are out of time or another thread has made this
+    // node pointless. The utility returned is then meaningless.
+    _MinMaxSearch_poll_time(search);
+    if (_MinMaxSearch_is_stopped(search)) {
+        return 0;
+    }
+
+    // We are exploring a new node.
+    search->stats.nodes_explored++;
+    _MINMAXSEARCH_PLY_STAT(search, ply, nodes_explored, 1);
+
+    // States in the endgame database need no further search.
+    if (search->endgame_utility) {
+
+        int utility;
+        if (search->endgame_utility(root->game_state, turn, &utility)) {
+            search->stats.endgame_hits++;
+            _MINMAXSEARCH_PLY_STAT(search, ply, endgame_hits, 1);
+            return utility;
+        }
+
+    }
+
+    // Check if our node is at depth or terminal.
+    int at_depth = depth <= 0;
+    int is_terminal = MINMAXSEARCH_IS_TERMINAL(search, root->game_state);
+    if (at_depth || is_terminal) {
+        _MINMAXSEARCH_PLY_STAT(search, ply, terminal_nodes, is_terminal);
+        _MINMAXSEARCH_PLY_STAT(search, ply, leaf_nodes, !is_terminal);
+        return MINMAXSEARCH_UTILITY(search, root->game_state, turn);
+    }
+
+    // Check if this is a dead state, lost for the player to play.
+    if (search->options.dead_state_pruning) {
+
+        int is_dead = MINMAXSEARCH_IS_DEAD_STATE(search, root->game_state, turn);
+        _MINMAXSEARCH_PLY_STAT(search, ply, dead_states, is_dead);
+        if (is_dead) {
+            return -INT_MAX;
+        }
+
+    }
+
+    // Consult the transposition table before generating any successors.
+    // Entries are only trusted at exactly the same depth, so the result of a search
+    // never depends on what else happens to be in the table.
+    int use_table = search->transposition_table && search->hash;
+    uint64_t key = 0;
+    int table_move = -1;
+    if (use_table) {
+
+        // Utilities are for the player to play, whose turn is part of the hash.
+        key = MINMAXSEARCH_HASH(search, root->game_state);
+        search->stats.table_probes++;
+        _MINMAXSEARCH_PLY_STAT(search, ply, table_probes, 1);
+
+        TranspositionEntry entry;
+        int probe = TranspositionTable_probe(search->transposition_table, key, &entry);
+        if (probe == TRANSPOSITION_HIT) {
+
+            search->stats.table_hits++;
+            _MINMAXSEARCH_PLY_STAT(search, ply, table_hits, 1);
+            table_move = entry.best_move;
+
+            if (entry.depth == depth) {
+
+                int is_exact = entry.bound == TRANSPOSITION_EXACT;
+                int is_above = entry.bound == TRANSPOSITION_LOWER && entry.utility >= beta;
+                int is_below = entry.bound == TRANSPOSITION_UPPER && entry.utility <= alpha;
+                if (is_exact || is_above || is_below) {
+                    return entry.utility;
+                }
+
+            }
+
+        } else if (probe == TRANSPOSITION_COLLISION) {
+            search->stats.table_collisions++;
+        }
+
+    }
+
+    int original_alpha = alpha;
+    int original_beta = beta;
+
+    // Find the children of this node and decide the order to search them in.
+    int moves[MINMAXSEARCH_MAX_MOVES];
+    int order[MINMAXSEARCH_MAX_MOVES];
+    _Alignas(max_align_t) unsigned char undo[MINMAXSEARCH_MAX_UNDO_SIZE];
+    int number_successors = MINMAXSEARCH_NAME(_MinMaxSearch_expand)(search, root, moves);
+    _MINMAXSEARCH_PLY_STAT(search, ply, nodes_generated, number_successors);
+
+    // While still on the previous iteration's principal variation, its move goes first.
+    int pv_move = -1;
+    if (search->pv.is_following && ply < search->pv.previous_length) {
+        pv_move = search->pv.previous[ply];
+    }
+
+    MINMAXSEARCH_NAME(_MinMaxSearch_order_children)(search, root, number_successors, moves, ply, table_move, pv_move, order);
+
+    if (pv_move < 0 || moves[order[0]] != pv_move) {
+        search->pv.is_following = 0;
+    }
+
+    int is_pvs = search->options.alpha_beta_pruning && search->options.algorithm == MINMAXSEARCH_PVS;
+
+    // Now, we may explore the successor nodes.
+    int best_utility = -INT_MAX;
+
+    // The position in the search order of the best child so far and its move.
+    int best_ordered_child = 0;
+    int best_move = moves[order[0]];
+
+    for (int k = 0; k < number_successors; k++) {
+
+        // With the first child searched, share the rest with any idle threads.
+        if (k > 0 && _MinMaxSearch_should_split(search, depth, number_successors - k)) {
+
+            _SplitPoint split = {
+                .root = root, .moves = moves, .order = order,
+                .is_root = 0, .player = turn,
+                .depth = depth,
+                .alpha = alpha, .beta = beta,
+                .best_utility = best_utility, .best_move = best_move,
+                .best_ordered_child = best_ordered_child
+            };
+            _MinMaxSearch_split(search, &split, k, number_successors);
+            _MinMaxSearch_merge_split_pv(search, &split, ply);
+
+            best_utility = split.best_utility;
+            best_move = split.best_move;
+            best_ordered_child = split.best_ordered_child;
+            break;
+
+        }
+
+        // Only the first child can lie on the previous principal variation.
+        if (k > 0) {
+            search->pv.is_following = 0;
+        }
+
+        int i = order[k];
+        int next_depth = depth - 1;
+
+        Node *child = MINMAXSEARCH_NAME(_MinMaxSearch_enter_child)(search, root, i, moves, undo);
+        int utility = MINMAXSEARCH_NAME(_MinMaxSearch_search_child)(search, child, turn, next_depth, alpha, beta, is_pvs && k > 0);
+        MINMAXSEARCH_NAME(_MinMaxSearch_leave_child)(search, root, undo);
+
+        if (_MinMaxSearch_is_stopped(search)) {
+            break;
+        }
+
+        if (utility > best_utility) {
+            best_utility = utility;
+            best_ordered_child = k;
+            best_move = moves[i];
+            _MinMaxSearch_update_pv(search, ply, moves[i]);
+        }
+
+        if (!search->options.alpha_beta_pruning) {
+            continue;
+        }
+
+        // Narrow the window and stop once the other player would never allow this node.
+        alpha = _max(alpha, best_utility);
+        if (alpha >= beta) {
+
+            if (turn == search->max_player) {
+                search->stats.beta_cutoffs++;
+            } else {
+                search->stats.alpha_cutoffs++;
+            }
+            _MINMAXSEARCH_PLY_STAT(search, ply, cutoffs, 1);
+
+            _MinMaxSearch_record_cutoff(search, turn, moves[i], ply, depth);
+            break;
+
+        }
+
+    }
+
+    // Streaming, the subtree below this node is never needed again.
+    if (search->options.streaming && !MINMAXSEARCH_IS_IN_PLACE(search)) {
+        _MinMaxSearch_discard_successors(search, root);
+    }
+
+    if (_MinMaxSearch_is_stopped(search)) {
+        return best_utility;
+    }
+
+    // Track how often the ordering put the best child first.
+    search->stats.nodes_ordered++;
+    if (best_ordered_child == 0) {
+        search->stats.first_child_best++;
+    }
+
+    // Remember what was learnt about this node.
+    if (use_table) {
+
+        int bound = TRANSPOSITION_EXACT;
+        if (best_utility <= original_alpha) {
+            bound = TRANSPOSITION_UPPER;
+        } else if (best_utility >= original_beta) {
+            bound = TRANSPOSITION_LOWER;
+        }
+
+        TranspositionTable_store(search->transposition_table, key, depth, best_utility, bound, best_move);
+        search->stats.table_stores++;
+
+    }
+
+    return best_utility;
+
+}
+
+#undef MINMAXSEARCH_NAME
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "mancala.h"
+#include "book.h"
+
+/**
+ * Builds or extends an opening book for minmax_player, e.g.
+ *
+ *     ./generate_book 6 3 4 14 book.bin
+ *
+ * Searches every position within 4 plays of a game of length 6 with 3 starting
+ * seeds to depth 14. Run again with other games to add them to the same book, or
+ * after an interruption to carry on.
+ */
+int main(int argc, char** argv) {
+
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <board length> <starting seeds> <plies> <depth> <path>\n", argv[0]);
+        return 1;
+    }
+
+    int length = atoi(argv[1]);
+    int starting_seeds = atoi(argv[2]);
+    int plies = atoi(argv[3]);
+    int depth = atoi(argv[4]);
+    const char *path = argv[5];
+
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (OpeningBook_build(path, length, starting_seeds, plies, depth, threads) != 0) {
+        fprintf(stderr, "Could not build the opening book at %s.\n", path);
+        return 1;
+    }
+
+    OpeningBook *book = OpeningBook_load(path);
+    if (book == NULL) {
+        fprintf(stderr, "Could not read back the opening book at %s.\n", path);
+        return 1;
+    }
+
+    printf("The book at %s holds %zu positions from %d games:\n", path, book->number_entries, book->number_configurations);
+    for (int i = 0; i < book->number_configurations; i++) {
+        OpeningBookConfiguration *configuration = book->configurations + i;
+        printf(
+            "  length %d with %d seeds, %d plies deep searched to depth %d.\n",
+            configuration->length, configuration->starting_seeds, configuration->plies, configuration->depth
+        );
+    }
+    OpeningBook_delete(book);
+
+    return 0;
+
+}
@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mancala.h"
+#include "endgame.h"
+
+/**
+ * Generates an endgame database for the search to map at runtime, e.g.
+ *
+ *     ./generate_endgame 6 16 endgame.db
+ *
+ * Solves every board of length 6 with at most 16 seeds left in the pits.
+ */
+int main(int argc, char** argv) {
+
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <board length> <max seeds> <path>\n", argv[0]);
+        return 1;
+    }
+
+    int length = atoi(argv[1]);
+    int max_seeds = atoi(argv[2]);
+    const char *path = argv[3];
+
+    if (EndgameTable_generate(path, length, max_seeds) != 0) {
+        fprintf(stderr, "Could not generate an endgame database of length %d with up to %d seeds at %s.\n", length, max_seeds, path);
+        return 1;
+    }
+
+    EndgameTable *table = EndgameTable_open(path);
+    if (table == NULL) {
+        fprintf(stderr, "Could not read back the endgame database at %s.\n", path);
+        return 1;
+    }
+
+    printf("Solved %llu positions of length %d with up to %d seeds into %s.\n", (unsigned long long) table->number_positions, length, max_seeds, path);
+    EndgameTable_close(table);
+
+    return 0;
+
+}
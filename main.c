@@ -2,12 +2,87 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "mancala.h"
 #include "gametree.h"
+#include "mancala_search.h"
+#include "endgame.h"
+#include "book.h"
+#include "tournament.h"
+#include "ponder.h"
+#include "mcts.h"
 
 typedef int (*player_function) (void *);
 
+// The memory given to the transposition table shared by every minmax_player search.
+#define MINMAX_TABLE_SIZE (16 * 1024 * 1024)
+
+TranspositionTable *minmax_table = NULL;
+
+// How minmax_player searches. With minmax_threads at 0 it uses every core.
+int minmax_depth = 12;
+int minmax_threads = 0;
+int minmax_verbose = 1;
+
+// The nodes explored by the last minmax_player search on each thread.
+_Thread_local long long minmax_nodes_explored = 0;
+
+long long minmax_last_nodes_explored() {
+    return minmax_nodes_explored;
+}
+
+// The endgame database used by minmax_player when one has been generated, see generate_endgame.c.
+#define MINMAX_ENDGAME_PATH "endgame.db"
+
+EndgameTable *minmax_endgame = NULL;
+
+int minmax_endgame_utility(GameBoard *board, int for_player, int *utility) {
+    return EndgameTable_probe(minmax_endgame, board, for_player, utility);
+}
+
+// The opening book used by minmax_player when one has been built, see generate_book.c.
+#define MINMAX_BOOK_PATH "book.bin"
+
+OpeningBook *minmax_book = NULL;
+
+// Searches on the opponent's time during console games, NULL when not pondering.
+Ponder *minmax_ponder = NULL;
+
+// The last minmax_player search on each thread, moved on by its own play, and the board
+// that play left. The next search carries on from it if the board can still be reached.
+_Thread_local MinMaxSearch minmax_search;
+_Thread_local GameBoard minmax_search_board;
+_Thread_local int minmax_has_search = 0;
+
+// The tree of the last search, rooted at the board its play left. It has no state when
+// there is no tree to carry on with.
+_Thread_local Node minmax_root;
+
+// The most plays the search is moved on by between two calls of minmax_player.
+#define MINMAX_MAX_FOLLOWED_PLAYS 16
+
+// The most nodes a single mcts_player search may grow its tree to.
+#define MCTS_MAX_NODES (1024 * 1024)
+
+// How mcts_player searches, within a budget of playouts or time. With mcts_threads
+// at 0 it uses every core.
+long long mcts_playouts = 100000;
+int mcts_time_limit_in_ms = -1;
+int mcts_threads = 0;
+int mcts_verbose = 1;
+
+// The playouts of the last mcts_player search on each thread, its closest count to nodes explored.
+_Thread_local long long mcts_playouts_made = 0;
+
+long long mcts_last_playouts() {
+    return mcts_playouts_made;
+}
+
+// Where random_player picks its pits from on each thread, seeded on first use.
+uint64_t random_player_seed = 1;
+_Thread_local uint64_t random_player_state = 0;
+
 int human_player(GameBoard *board) {
 
     int pit_to_play = -1;
@@ -53,52 +128,286 @@ int last_player(GameBoard *board) {
 
 int random_player(GameBoard *board) {
 
-    // Find all valid plays
-    int all_plays[board->length];
-    memset(all_plays, 0, board->length * sizeof(int));
+    if (random_player_state == 0) {
+        random_player_state = GameBoard_seed_random(random_player_seed);
+    }
 
-    int valid_plays = 0;
-    for (int i = 0; i < board->length; i++) {
+    // Only the pit is wanted, so it is played on a copy.
+    GameBoard next = *board;
+    return GameBoard_play_random(&next, &random_player_state);
+
+}
+
+/**
+ * Sets up a search the way minmax_player searches.
+ */
+void minmax_setup_search(MinMaxSearch *search) {
+
+    memset(search, 0, sizeof(MinMaxSearch));
+
+    search->options.max_depth = minmax_depth;
+    search->options.iterative_deepening = 1;
+    search->options.starting_depth = 1;
+    search->options.depth_step = 1;
+    search->options.time_limit_in_ms = -1;
+    search->options.aspiration_window = 2;
+    search->options.dead_state_pruning = 1;
+    search->options.alpha_beta_pruning = 1;
+    search->options.order_static = 1;
+    search->options.order_killers = 1;
+    search->options.order_history = 1;
+    search->options.threads = minmax_threads > 0 ? minmax_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    search->options.split_depth = 4;
+    search->options.streaming = 1;
+
+    // Search below the root in place, calling the board directly.
+    GameBoard_setup_search(search);
+
+    search->transposition_table = minmax_table;
+
+    if (minmax_endgame != NULL) {
+        search->endgame_utility = (int (*) (void *, int, int *)) &minmax_endgame_utility;
+    }
+
+    MinMaxSearch_reset_stats(search);
+
+}
+
+/**
+ * Finds the plays that lead from one board to another within the turn of the player
+ * to play. Fills in at most max_plays of them and returns how many there are, or -1
+ * if the board can not be reached.
+ */
+int minmax_find_plays(GameBoard *from, GameBoard *to, int *plays, int max_plays) {
 
-        if (board->lanes[board->turn] > 0) {
-            all_plays[valid_plays] = i;
-            valid_plays++;
+    if (GameBoard_is_same_position(from, to)) {
+        return 0;
+    }
+
+    if (max_plays == 0 || GameBoard_is_game_over(from)) {
+        return -1;
+    }
+
+    for (int pit = 0; pit < from->length; pit++) {
+
+        if (!GameBoard_is_valid_play(from, pit)) {
+            continue;
+        }
+
+        GameBoard next = *from;
+        GameBoard_play_turn(&next, pit);
+
+        // Once the turn passes, the board must have been reached.
+        int number_plays = -1;
+        if (next.turn == from->turn) {
+            number_plays = minmax_find_plays(&next, to, plays + 1, max_plays - 1);
+        } else if (GameBoard_is_same_position(&next, to)) {
+            number_plays = 0;
+        }
+
+        if (number_plays >= 0) {
+            plays[0] = pit;
+            return number_plays + 1;
         }
 
     }
 
-    int to_play = random() % valid_plays;
-    return all_plays[to_play];
+    return -1;
+
+}
+
+/**
+ * Frees the tree kept from the last search, if there is one.
+ */
+void minmax_drop_tree() {
+
+    if (minmax_root.game_state != NULL) {
+        Node_cleanup(&minmax_root, minmax_search.free_state);
+        minmax_root.game_state = NULL;
+    }
+
+}
+
+/**
+ * Moves the search on by its own play and remembers the board it leaves, then starts
+ * pondering the opponent's replies if the play ends the turn. The search's principal
+ * variation, moved on past the play, predicts the replies.
+ *
+ * Given the kept tree as root, it moves on to the play's subtree. Otherwise the
+ * tree no longer matches the board and is dropped.
+ */
+void minmax_play(GameBoard *board, Node *root, int pit_to_play) {
+
+    if (root == NULL) {
+        minmax_drop_tree();
+    }
+
+    if (!MinMaxSearch_advance(&minmax_search, root, pit_to_play)) {
+        minmax_drop_tree();
+        minmax_has_search = 0;
+        return;
+    }
+
+    minmax_search_board = *board;
+    GameBoard_play_turn(&minmax_search_board, pit_to_play);
+    minmax_has_search = 1;
+
+    GameBoard *next = &minmax_search_board;
+    if (minmax_ponder == NULL || next->turn == board->turn || GameBoard_is_game_over(next)) {
+        return;
+    }
+
+    Ponder_start(minmax_ponder, next, minmax_search.pv.previous, minmax_search.pv.previous_length);
 
 }
 
 int minmax_player(GameBoard *board) {
 
-    // Initialize our search tree;
-    MinMaxSearch search;
-    search.depth = 10;
+    // Take over from pondering, which may already have searched this position.
+    PonderResult pondered;
+    int is_pondered = minmax_ponder != NULL && Ponder_finish(minmax_ponder, board, &pondered);
+
+    // Carry on from the last search through every play made since, or start afresh.
+    MinMaxSearch *search = &minmax_search;
+    int plays[MINMAX_MAX_FOLLOWED_PLAYS];
+    int number_plays = -1;
+    if (minmax_has_search) {
+        number_plays = minmax_find_plays(&minmax_search_board, board, plays, MINMAX_MAX_FOLLOWED_PLAYS);
+    }
+
+    // The tree follows the same plays, as long as one is kept.
+    Node *carried_root = minmax_root.game_state != NULL ? &minmax_root : NULL;
+    for (int i = 0; i < number_plays; i++) {
+        if (!MinMaxSearch_advance(search, carried_root, plays[i])) {
+            number_plays = -1;
+            break;
+        }
+    }
+
+    if (number_plays < 0) {
+        minmax_drop_tree();
+        minmax_setup_search(search);
+    } else {
+        MinMaxSearch_reset_stats(search);
+    }
+
+    // Play straight from the book while the game is still in it.
+    OpeningBookEntry book_entry;
+    if (minmax_book != NULL && OpeningBook_probe(minmax_book, board, &book_entry) && GameBoard_is_valid_play(board, book_entry.best_move)) {
+        if (minmax_verbose) {
+            printf("From the opening book with utility %d at depth %d.\n", book_entry.utility, book_entry.depth);
+        }
+        minmax_nodes_explored = 0;
+        minmax_play(board, NULL, book_entry.best_move);
+        return book_entry.best_move;
+    }
 
-    search.utility = (int (*) (void *, int)) &GameBoard_utility;
-    search.is_terminal = (int (*) (void *)) &GameBoard_is_game_over;
-    search.get_turn = (int (*) (void *)) &GameBoard_current_turn;
-    search.get_successors = (int (*) (void *, void ***)) &GameBoard_get_successors;
-    search.free_state = (void (*) (void *)) &GameBoard_delete;
+    if (is_pondered) {
+        if (minmax_verbose) {
+            printf(
+                "Pondered with utility %d, %lld nodes explored in %lldms on the opponent's time.\n",
+                pondered.best_utility, pondered.nodes_explored, pondered.search_ns / 1000000
+            );
+        }
+        minmax_nodes_explored = pondered.nodes_explored;
+
+        // The pondered search knows better what follows than the one carried on.
+        search->pv.previous_length = pondered.pv_length;
+        for (int i = 0; i < pondered.pv_length; i++) {
+            search->pv.previous[i] = pondered.pv[i];
+        }
+        search->pv.is_named = 1;
+
+        minmax_play(board, NULL, pondered.best_move);
+        return pondered.best_move;
+    }
 
-    MinMaxSearch_reset_stats(&search);
+    #ifdef ARENA
+        // Every board of the search is released at once when it is done.
+        size_t arena_mark_before_search = arena_mark();
+    #endif
 
-    Node root;
-    root.game_state = board;
-    root.number_successors = -1;
+    // Without a tree carried over, the search starts one at a copy of the board.
+    if (minmax_root.game_state == NULL) {
+        minmax_root.game_state = GameBoard_copy(board);
+        minmax_root.number_successors = -1;
+        minmax_root.successors = NULL;
+    }
 
-    Node *to_play = MinMaxSearch_search(&search, &root);
-    MinMaxSearch_print_stats(&search);
+    Node *to_play = MinMaxSearch_search(search, &minmax_root);
+    if (minmax_verbose) {
+        MinMaxSearch_write_stats(search, stdout, MINMAXSEARCH_STATS_TEXT);
+    }
+    minmax_nodes_explored = search->stats.nodes_explored;
 
     // Extract the last turn.
     int pit_to_play = ((GameBoard *) to_play->game_state)->play_made.pit_played;
 
-    // Clean up our search.
-    root.game_state = NULL;
-    Node_cleanup(&root, search.free_state);
+    // Move the tree on to the play, keeping its subtree for the next search.
+    minmax_play(board, &minmax_root, pit_to_play);
+
+    #ifdef ARENA
+        // The arena is released, so the tree can not be kept past the search.
+        minmax_drop_tree();
+        arena_reset_to(arena_mark_before_search);
+    #endif
+
+    return pit_to_play;
+
+}
+
+/**
+ * Plays a board out at random for mcts_player, on a copy so the board is left as it was.
+ */
+int mcts_playout(GameBoard *board, uint64_t *random_state) {
+
+    GameBoard copy = *board;
+    return GameBoard_playout(&copy, random_state);
+
+}
+
+/**
+ * Sets up a Monte Carlo search the way mcts_player searches.
+ */
+void mcts_setup_search(MCTSSearch *search) {
+
+    memset(search, 0, sizeof(MCTSSearch));
+
+    search->options.max_playouts = mcts_playouts;
+    search->options.time_limit_in_ms = mcts_time_limit_in_ms;
+    search->options.exploration = 1.4;
+    search->options.max_nodes = MCTS_MAX_NODES;
+    search->options.virtual_loss = 1;
+    search->options.threads = mcts_threads > 0 ? mcts_threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+    search->utility = (int (*) (void *, int)) &GameBoard_utility;
+    search->is_terminal = (int (*) (void *)) &GameBoard_is_game_over;
+    search->get_turn = (int (*) (void *)) &GameBoard_current_turn;
+    search->get_moves = (int (*) (void *, int *)) &GameBoard_get_moves;
+    search->make_move = (void (*) (void *, int, void *)) &GameBoard_make_move;
+    search->unmake_move = (void (*) (void *, void *)) &GameBoard_unmake_move;
+    search->undo_size = sizeof(GameBoardUndo);
+    search->copy_state = (void *(*) (void *)) &GameBoard_copy;
+    search->free_state = (void (*) (void *)) &GameBoard_delete;
+    search->playout = (int (*) (void *, uint64_t *)) &mcts_playout;
+
+}
+
+int mcts_player(GameBoard *board) {
+
+    MCTSSearch search;
+    mcts_setup_search(&search);
+
+    // Seeding from the position plays the same game again on a single thread.
+    search.options.seed = GameBoard_hash(board);
+
+    // The search plays on a board of its own, leaving the game's alone.
+    GameBoard root = *board;
+    int pit_to_play = MCTSSearch_search(&search, &root);
+    if (mcts_verbose) {
+        MCTSSearch_print_stats(&search);
+    }
+    mcts_playouts_made = search.stats.playouts;
 
     return pit_to_play;
 
@@ -140,6 +449,12 @@ void run_console_game(int board_length, int starting_seeds, player_function play
 
     }
 
+    // Nothing is left to ponder.
+    if (minmax_ponder != NULL) {
+        Ponder_stop(minmax_ponder);
+        Ponder_print(minmax_ponder);
+    }
+
     int winner = GameBoard_winner_is(board);
     if (winner == -1) {
         printf("\nThe game is a draw!\n");
@@ -151,9 +466,68 @@ void run_console_game(int board_length, int starting_seeds, player_function play
     GameBoard_delete(board);
 
     #ifdef ARENA
+        arena_print();
         arena_teardown();
     #endif
 
+    #ifdef POOL
+        pool_print();
+        Node_print_pool();
+    #endif
+
+}
+
+/**
+ * Plays every computer player against every other without printing the games.
+ *
+ * Takes the arguments following "tournament" on the command line.
+ */
+int run_tournament(int argc, char** argv) {
+
+    if (argc != 8) {
+        fprintf(
+            stderr,
+            "Usage: mancala tournament <games per pairing> <board length> <starting seeds> "
+            "<random opening plies> <minmax depth> <mcts playouts> <games csv> <summary csv>\n"
+        );
+        return 1;
+    }
+
+    TournamentPlayer players[] = {
+        { "minmax", &minmax_player, &minmax_last_nodes_explored },
+        { "mcts", &mcts_player, &mcts_last_playouts },
+        { "random", &random_player, NULL },
+        { "first", &first_player, NULL },
+        { "last", &last_player, NULL },
+    };
+
+    TournamentOptions options;
+    options.games_per_pairing = atoi(argv[0]);
+    options.length = atoi(argv[1]);
+    options.starting_seeds = atoi(argv[2]);
+    options.opening_plies = atoi(argv[3]);
+    options.seed = 1;
+    options.threads = sysconf(_SC_NPROCESSORS_ONLN);
+    options.games_path = argv[6];
+    options.summary_path = argv[7];
+
+    // Each game gets a core of its own, so every search runs on a single thread.
+    minmax_depth = atoi(argv[4]);
+    minmax_threads = 1;
+    minmax_verbose = 0;
+    mcts_playouts = atoll(argv[5]);
+    mcts_threads = 1;
+    mcts_verbose = 0;
+
+    int result = Tournament_run(players, sizeof(players) / sizeof(players[0]), &options);
+
+    if (result != 0) {
+        fprintf(stderr, "Could not run the tournament.\n");
+        return 1;
+    }
+
+    return 0;
+
 }
 
 int main(int argc, char** argv) {
@@ -161,12 +535,45 @@ int main(int argc, char** argv) {
     int board_length = 6;
     int starting_seeds = 3;
 
-    // run_console_game(board_length, starting_seeds, &human_player, &random_player);
-    run_console_game(board_length, starting_seeds, &minmax_player, &random_player);
-    // run_console_game(board_length, starting_seeds, &human_player, &minmax_player);
-    // run_console_game(board_length, starting_seeds, &first_player, &minmax_player);
-    // run_console_game(board_length, starting_seeds, &last_player, &minmax_player);
+    // Entries stay valid between turns and games, so one table is kept for the whole run.
+    minmax_table = TranspositionTable_create(MINMAX_TABLE_SIZE);
 
-    return 0;
+    // Without a database the search simply plays on to the end of the game.
+    minmax_endgame = EndgameTable_open(MINMAX_ENDGAME_PATH);
+    minmax_book = OpeningBook_load(MINMAX_BOOK_PATH);
+
+    int result = 0;
+    if (argc > 1 && strcmp(argv[1], "tournament") == 0) {
+
+        result = run_tournament(argc - 2, argv + 2);
+
+    } else {
+
+        // The engine keeps searching while its opponent thinks.
+        minmax_ponder = Ponder_create(&minmax_setup_search);
+
+        // run_console_game(board_length, starting_seeds, &human_player, &random_player);
+        run_console_game(board_length, starting_seeds, &minmax_player, &random_player);
+        // run_console_game(board_length, starting_seeds, &human_player, &minmax_player);
+        // run_console_game(board_length, starting_seeds, &first_player, &minmax_player);
+        // run_console_game(board_length, starting_seeds, &last_player, &minmax_player);
+        // run_console_game(board_length, starting_seeds, &mcts_player, &minmax_player);
+
+    }
+
+    if (minmax_ponder != NULL) {
+        Ponder_delete(minmax_ponder);
+    }
+    if (minmax_table != NULL) {
+        TranspositionTable_delete(minmax_table);
+    }
+    if (minmax_endgame != NULL) {
+        EndgameTable_close(minmax_endgame);
+    }
+    if (minmax_book != NULL) {
+        OpeningBook_delete(minmax_book);
+    }
+
+    return result;
 
 }
\ No newline at end of file
@@ -1,32 +1,127 @@
 #include "mancala.h"
+#include "mancala_kernels.h"
 
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if GAMEBOARD_MAX_LENGTH <= 12
+    _Static_assert(sizeof(GameBoard) <= 64, "A standard GameBoard should fit within a cache line.");
+#endif
 
 #ifdef ARENA
+    #include <pthread.h>
     #include "arena.h"
-    Arena *arena;
+
+    // Every thread allocates its boards from an arena of its own.
+    _Thread_local Arena *arena = NULL;
+
+    // Frees the arena of a thread that exits without tearing it down.
+    static pthread_key_t arena_key;
+    static pthread_once_t arena_key_once = PTHREAD_ONCE_INIT;
+
+    static void _arena_destroy(void *thread_arena) {
+
+        Arena_delete(thread_arena);
+
+    }
+
+    static void _arena_create_key() {
+
+        pthread_key_create(&arena_key, &_arena_destroy);
+
+    }
 
     void arena_setup() {
 
+        if (arena != NULL) {
+            return;
+        }
+
+        pthread_once(&arena_key_once, &_arena_create_key);
         arena = Arena_create(sizeof(GameBoard), 10000);
+        pthread_setspecific(arena_key, arena);
 
     }
 
     void arena_teardown() {
 
+        if (arena == NULL) {
+            return;
+        }
+
+        pthread_setspecific(arena_key, NULL);
         Arena_delete(arena);
+        arena = NULL;
+
+    }
+
+    size_t arena_mark() {
+
+        arena_setup();
+        return Arena_mark(arena);
+
+    }
+
+    void arena_reset_to(size_t mark) {
+
+        Arena_reset_to(arena, mark);
+
+    }
+
+    void arena_print() {
+
+        if (arena != NULL) {
+            Arena_print(arena);
+        }
+
+    }
+
+#endif
+
+#ifdef POOL
+    #if defined(ARENA)
+        #error "Only one of ARENA and POOL may be defined."
+    #endif
+
+    #include <pthread.h>
+    #include "pool.h"
+
+    // The number of boards carved from memory at once.
+    #define GAMEBOARD_POOL_SLAB 4096
+
+    // Every thread shares one pool of boards, created on first use.
+    static Pool *board_pool;
+    static pthread_once_t board_pool_once = PTHREAD_ONCE_INIT;
+
+    static void _board_pool_create() {
+
+        board_pool = Pool_create(sizeof(GameBoard), GAMEBOARD_POOL_SLAB);
+
+    }
+
+    void pool_print() {
+
+        if (board_pool != NULL) {
+            Pool_print(board_pool);
+        }
 
     }
 
 #endif
 
-// Provides an arena allocator for gameboards.
+// Provides an arena or pool allocator for gameboards.
 static inline GameBoard *_GameBoard_malloc() {
 
 #ifdef ARENA
+    if (arena == NULL) {
+        arena_setup();
+    }
     return Arena_allocate(arena);
+#elif defined(POOL)
+    pthread_once(&board_pool_once, &_board_pool_create);
+    return board_pool != NULL ? Pool_allocate(board_pool) : NULL;
 #else
     return malloc(sizeof(GameBoard));
 #endif
@@ -36,6 +131,8 @@ static inline GameBoard *_GameBoard_malloc() {
 static inline void _GameBoard_free(GameBoard *board) {
 
 #ifdef ARENA
+#elif defined(POOL)
+    Pool_free(board_pool, board);
 #else
     return free(board);
 #endif
@@ -44,6 +141,17 @@ static inline void _GameBoard_free(GameBoard *board) {
 
 GameBoard *GameBoard_create(int length, int starting_seeds) {
 
+    if (length <= 0 || length > GAMEBOARD_MAX_LENGTH) {
+        printf("Board length must be between 1 and %d.\n", GAMEBOARD_MAX_LENGTH);
+        return NULL;
+    }
+
+    // Every seed may end up in a single store, which must still hold them all.
+    if (starting_seeds < 0 || 2LL * length * starting_seeds > UINT16_MAX) {
+        printf("Starting seeds must be between 0 and %d for a board of length %d.\n", UINT16_MAX / (2 * length), length);
+        return NULL;
+    }
+
     GameBoard *board = _GameBoard_malloc();
 
     if (board == NULL) {
@@ -51,20 +159,18 @@ GameBoard *GameBoard_create(int length, int starting_seeds) {
         return NULL;
     }
 
+    // Zero the whole board so that unused pits never hold stale seeds.
+    memset(board, 0, sizeof(GameBoard));
+
     // Set defaults of board.
     board->length = length;
 
-    board->lanes[0] = malloc(sizeof(int) * length);
-    board->lanes[1] = malloc(sizeof(int) * length);
-    // TODO: Safe.
-
     for (int i = 0; i < length; i++) {
         board->lanes[0][i] = starting_seeds;
         board->lanes[1][i] = starting_seeds;
     }
-
-    board->stores[0] = 0;
-    board->stores[1] = 0;
+    board->totals[0] = length * starting_seeds;
+    board->totals[1] = length * starting_seeds;
 
     board->turn = 0;
 
@@ -79,25 +185,15 @@ GameBoard *GameBoard_create(int length, int starting_seeds) {
 
 GameBoard *GameBoard_copy(GameBoard *board) {
 
-    GameBoard *new_board = GameBoard_create(board->length, 0);
-
-    // Copy the stores.
-    new_board->stores[0] = board->stores[0];
-    new_board->stores[1] = board->stores[1];
-
-    // Copy the turn.
-    new_board->turn = board->turn;
-
-    // Copy the lanes.
-    for (int i = 0; i < board->length; i++) {
-
-        new_board->lanes[0][i] = board->lanes[0][i];
-        new_board->lanes[1][i] = board->lanes[1][i];
+    GameBoard *new_board = _GameBoard_malloc();
 
+    if (new_board == NULL) {
+        printf("Failed to allocate game board.\n");
+        return NULL;
     }
 
-    // Copy the play made.
-    new_board->play_made = board->play_made;
+    // The board holds no pointers so a flat copy is a full copy.
+    memcpy(new_board, board, sizeof(GameBoard));
 
     return new_board;
 
@@ -105,9 +201,6 @@ GameBoard *GameBoard_copy(GameBoard *board) {
 
 void GameBoard_delete(GameBoard *board) {
 
-    free(board->lanes[0]);
-    free(board->lanes[1]);
-
     _GameBoard_free(board);
 
 }
@@ -168,208 +261,165 @@ void GameBoard_print(GameBoard *board) {
 
 int GameBoard_play_turn(GameBoard *board, int pit_to_play) {
 
-    // Constraints:
-    //  * pit_to_play < board->length
-    //  * board->lane_(board->turn) > 0
+    seed_t seeds_captured;
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_play_turn(board, length, pit_to_play, &seeds_captured));
 
-    // Record this play.
-    board->play_made.pit_played = pit_to_play;
-    board->play_made.turn = board->turn;
-    board->play_made.was_capture = 0;
-    board->play_made.was_chain = 0;
+}
 
-    int starting_turn = board->turn;
+void GameBoard_make_move(GameBoard *board, int pit_to_play, GameBoardUndo *undo) {
 
-    int *playing_lane = board->lanes[starting_turn];
-    int *playing_store = &(board->stores[starting_turn]);
+    GAMEBOARD_WITH_LENGTH(board, _GameBoard_make_move(board, length, pit_to_play, undo));
 
-    // Empty the played pit.
-    int seeds_left = playing_lane[pit_to_play];
-    playing_lane[pit_to_play] = 0;
+}
 
-    // Advance the pit index past the emptied one.
-    pit_to_play++;
+void GameBoard_unmake_move(GameBoard *board, GameBoardUndo *undo) {
 
-    // Distribute the seeds into the next pits.
-    int current_turn = starting_turn;
-    while (seeds_left > 0) {
+    GAMEBOARD_WITH_LENGTH(board, _GameBoard_unmake_move(board, length, undo));
 
-        if (pit_to_play < board->length) {
+}
 
-            playing_lane[pit_to_play]++;
-            pit_to_play++;
-            seeds_left--;
+int GameBoard_is_valid_play(GameBoard *board, int pit_to_play) {
 
-        } else {
+    // Check that the pit is a valid index.
+    int valid_index = pit_to_play >= 0 && pit_to_play < board->length;
 
-            // Place a pit in this players store.
-            if (current_turn == starting_turn) {
-                (*playing_store)++;
-                seeds_left--;
-            }
+    // Check that the pit has a non-zero number of seeds.
+    int valid_pit = board->lanes[board->turn][pit_to_play] > 0;
 
-            // Swap to the other lane.
-            pit_to_play = 0;
-            current_turn = (current_turn + 1) % 2;
-            playing_lane = board->lanes[current_turn];
+    return valid_index && valid_pit;
 
-        }
+}
 
-    }
+int GameBoard_is_same_position(GameBoard *a, GameBoard *b) {
 
-    // Check for end-of-turn conditions.
-    if (current_turn != starting_turn && pit_to_play == 0) {
-        // Ended in own store. The player takes another turn.
-        board->play_made.was_chain = 1;
-    } else {
-        board->turn = (board->turn + 1) % 2;
+    if (a->length != b->length || a->turn != b->turn) {
+        return 0;
     }
 
-    if (current_turn == starting_turn && pit_to_play > 0) {
+    for (int player = 0; player < 2; player++) {
 
-        int landed_in_pit_index = pit_to_play - 1;
-        int landed_in_pit = playing_lane[landed_in_pit_index];
-        int opponents_turn = (starting_turn + 1) % 2;
-        int adjacent_pit_index = board->length - landed_in_pit_index - 1;
-        int adjacent_pit = board->lanes[opponents_turn][adjacent_pit_index];
-
-        if (adjacent_pit > 0 && landed_in_pit == 1) {
-
-            board->lanes[opponents_turn][adjacent_pit_index] = 0;
-            playing_lane[landed_in_pit_index] = 0;
-            (*playing_store) += adjacent_pit + 1;
-
-            board->play_made.was_capture = 1;
+        if (a->stores[player] != b->stores[player]) {
+            return 0;
+        }
 
+        for (int i = 0; i < a->length; i++) {
+            if (a->lanes[player][i] != b->lanes[player][i]) {
+                return 0;
+            }
         }
 
     }
 
-    return board->turn;
+    return 1;
 
 }
 
-int GameBoard_is_valid_play(GameBoard *board, int pit_to_play) {
+void GameBoard_update_totals(GameBoard *board) {
 
-    // Check that the pit is a valid index.
-    int valid_index = pit_to_play >= 0 && pit_to_play < board->length;
+    for (int player = 0; player < 2; player++) {
 
-    // Check that the pit has a non-zero number of seeds.
-    int valid_pit = board->lanes[board->turn][pit_to_play] > 0;
+        int total = 0;
+        for (int i = 0; i < board->length; i++) {
+            total += board->lanes[player][i];
+        }
+        board->totals[player] = total;
 
-    return valid_index && valid_pit;
+    }
 
 }
 
 int GameBoard_is_game_over(GameBoard *board) {
 
-    int *lane_0 = board->lanes[0];
-    int *lane_1 = board->lanes[1];
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_is_game_over(board, length));
 
-    int lane_0_empty = 1;
-    int lane_1_empty = 1;
+}
 
-    for (int i = 0; i < board->length; i++) {
+int GameBoard_winner_is(GameBoard *board) {
 
-        lane_0_empty &= (lane_0[i] == 0);
-        lane_1_empty &= (lane_1[i] == 0);
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_winner_is(board, length));
 
-    }
+}
+
+int GameBoard_score_of(GameBoard *board, int player) {
 
-    return lane_0_empty || lane_1_empty;
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_score_of(board, length, player));
 
 }
 
-int GameBoard_winner_is(GameBoard *board) {
+static inline int _GameBoard_get_successors(GameBoard *board, int length, GameBoard ***successors) {
 
-    int score_0 =  GameBoard_score_of(board, 0);
-    int score_1 =  GameBoard_score_of(board, 1);
+    // First, find which pits we can play from.
+    int valid_pits[GAMEBOARD_MAX_LENGTH];
+    int number_valid_pits = _GameBoard_get_moves(board, length, valid_pits);
 
-    if (score_0 > score_1) {
-        // Player 0 won.
-        return 0;
-    }
+    // Create a copy of this board and a successor for each possible play.
+    *successors = malloc(sizeof(GameBoard *) * number_valid_pits);
 
-    if (score_0 == score_1) {
-        // Tie.
-        return -1;
-    }
+    for (int i = 0; i < number_valid_pits; i++) {
 
-    // Player 1 won.
-    return 1;
+        (*successors)[i] = GameBoard_copy(board);
 
-}
-
-int GameBoard_score_of(GameBoard *board, int player) {
+        // Play the turn;
+        seed_t seeds_captured;
+        _GameBoard_play_turn((*successors)[i], length, valid_pits[i], &seeds_captured);
 
-    int score = board->stores[player];
-    for (int i = 0; i < board->length; i++) {
-        score += board->lanes[player][i];
     }
 
-    return score;
+    return number_valid_pits;
 
 }
 
 int GameBoard_get_successors(GameBoard *board, GameBoard ***successors) {
 
-    // First, find which pits we can play from.
-    int *playing_lane = board->lanes[board->turn];
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_get_successors(board, length, successors));
 
-    int number_valid_pits = 0;
-    int valid_pits[board->length];
-    for (int i = 0; i < board->length; i++) {
-        int valid = playing_lane[i] > 0;
+}
 
-        number_valid_pits += valid;
-        valid_pits[i] = valid;
-    }
+int GameBoard_get_moves(GameBoard *board, int *moves) {
 
-    // Create a copy of this board and a successor for each possible play.
-    *successors = malloc(sizeof(GameBoard *) * number_valid_pits);
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_get_moves(board, length, moves));
 
-    for (int i = 0, current_play = 0; i < board->length; i++) {
-        if (!valid_pits[i]) {
-            continue;
-        }
+}
 
-        (*successors)[current_play] = GameBoard_copy(board);
+uint64_t GameBoard_seed_random(uint64_t seed) {
 
-        // Play the turn;
-        GameBoard_play_turn((*successors)[current_play], i);
+    // A xorshift sequence never leaves 0.
+    uint64_t random_state = _GameBoard_mix(seed);
+    return random_state != 0 ? random_state : 1;
 
-        current_play++;
+}
 
-    }
+int GameBoard_play_random(GameBoard *board, uint64_t *random_state) {
 
-    return number_valid_pits;
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_play_random(board, length, random_state));
 
 }
 
-int GameBoard_utility(GameBoard *board, int for_player) {
+int GameBoard_playout(GameBoard *board, uint64_t *random_state) {
 
-    // If the game is over, this is the best (or worst) possible move.
-    if (GameBoard_is_game_over(board)) {
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_playout(board, length, random_state));
 
-        int winner = GameBoard_winner_is(board);
+}
 
-        // Tie.
-        if (winner == -1) {
-            return 0;
-        }
+uint64_t GameBoard_hash(GameBoard *board) {
 
-        if (winner == for_player) {
-            return INT_MAX;
-        }
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_hash(board, length));
 
-        // Loser.
-        return INT_MIN;
-    }
+}
+
+int GameBoard_move_made(GameBoard *board) {
+    return board->play_made.pit_played;
+}
 
-    // We will calculate many different heuristics and take a weighted sum of them.
-    int score_advantage = board->stores[for_player] - board->stores[(for_player + 1) % 2];
+int GameBoard_move_hint(GameBoard *board, int pit_to_play) {
 
-    return score_advantage;
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_move_hint(board, length, pit_to_play));
+
+}
+
+int GameBoard_utility(GameBoard *board, int for_player) {
+
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_utility(board, length, for_player));
 
 }
 
@@ -379,13 +429,6 @@ int GameBoard_current_turn(GameBoard *board) {
 
 int GameBoard_is_dead_state(GameBoard *board, int for_player) {
 
-    int seeds_left = 0;
-    for (int i = 0; i < board->length; i++) {
-        seeds_left += board->lanes[0][i];
-        seeds_left += board->lanes[1][i];
-    }
-
-    int possible_score = board->stores[for_player] + seeds_left;
-    return possible_score < board->stores[(for_player + 1) % 2];
+    GAMEBOARD_WITH_LENGTH(board, return _GameBoard_is_dead_state(board, length, for_player));
 
-}
\ No newline at end of file
+}
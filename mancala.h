@@ -1,28 +1,112 @@
+#include <stddef.h>
+#include <stdint.h>
 
+// The largest board length supported by a GameBoard.
+// The default keeps a standard board within a single cache line.
+#ifndef GAMEBOARD_MAX_LENGTH
+    #define GAMEBOARD_MAX_LENGTH 12
+#endif
+
+// The type of a single pit or store.
+typedef uint16_t seed_t;
+
+// The weights of the heuristics GameBoard_utility sums up, tuned by playing the
+// search against itself on boards of 4 to 7 pits.
+#ifndef GAMEBOARD_WEIGHT_STORES
+    #define GAMEBOARD_WEIGHT_STORES 8
+#endif
+#ifndef GAMEBOARD_WEIGHT_LANES
+    #define GAMEBOARD_WEIGHT_LANES 1
+#endif
+#ifndef GAMEBOARD_WEIGHT_CHAINS
+    #define GAMEBOARD_WEIGHT_CHAINS 8
+#endif
+#ifndef GAMEBOARD_WEIGHT_CAPTURES
+    #define GAMEBOARD_WEIGHT_CAPTURES 4
+#endif
+
+/**
+ * Describes the last play made on a board.
+ * All fields are -1 before the first play.
+ */
+typedef struct {
+    int8_t pit_played;
+    int8_t turn;
+    int8_t was_capture;
+    int8_t was_chain;
+} GameBoardPlay;
+
+/**
+ * A GameBoard is a fixed-size value with all of its pits and stores stored inline.
+ * Copying a board is a single memcpy of sizeof(GameBoard) and only the first
+ * `length` pits of each lane are used, the rest are kept at zero.
+ *
+ * The seeds in each lane are also kept counted as the board is played, so whether
+ * the game is over and the scores never need the pits to be added up. Code setting
+ * pits directly must count them again with GameBoard_update_totals.
+ */
 typedef struct {
 
-    int length;
-    int *lanes[2];
-    int stores[2];
+    seed_t lanes[2][GAMEBOARD_MAX_LENGTH];
+    seed_t stores[2];
+    seed_t totals[2]; // The seeds in each lane.
 
-    int turn; // 0 or 1 for the next player to play.
+    int8_t length;
+    int8_t turn; // 0 or 1 for the next player to play.
 
-    struct {
-        int pit_played;
-        int turn;
-        int was_capture;
-        int was_chain;
-    } play_made;
+    GameBoardPlay play_made;
 
 } GameBoard;
 
+/**
+ * Everything needed to take back a play made with GameBoard_make_move.
+ */
+typedef struct {
+
+    // The play being taken back.
+    int8_t pit_played;
+    int8_t turn;
+    seed_t seeds_sown;
+
+    // Seeds taken from the opponent's pit by a capture, 0 if there was none.
+    seed_t seeds_captured;
+
+    // The play recorded on the board before this one.
+    GameBoardPlay previous_play;
+
+} GameBoardUndo;
+
 #ifdef ARENA
+    /**
+     * Creates and destroys the arena of the calling thread. A thread that allocates
+     * a board without one creates it then, and it is freed when the thread exits.
+     */
     void arena_setup();
     void arena_teardown();
+
+    /**
+     * Marks the arena of the calling thread, and later frees every board allocated
+     * by the thread since.
+     */
+    size_t arena_mark();
+    void arena_reset_to(size_t mark);
+
+    void arena_print();
+#endif
+
+#ifdef POOL
+    /**
+     * Prints the statistics of the pool every board is allocated from.
+     */
+    void pool_print();
 #endif
 
 /**
  * Allocates and deallocates resources for a game of Mancala.
+ *
+ * Returns NULL if the board could not be allocated, the length is larger than
+ * GAMEBOARD_MAX_LENGTH, the starting seeds are negative or there are more seeds in
+ * all than a seed_t holds (UINT16_MAX).
  */
 GameBoard *GameBoard_create(int length, int starting_seeds);
 GameBoard *GameBoard_copy(GameBoard *board);
@@ -57,11 +141,31 @@ void GameBoard_print(GameBoard *board);
  */
 int GameBoard_play_turn(GameBoard *board, int pit_to_play);
 
+/**
+ * Plays a turn in place like GameBoard_play_turn while filling in an undo record.
+ * Passing the record to GameBoard_unmake_move restores the board exactly.
+ *
+ * Assumes the input is a valid play (see `_is_valid_play`).
+ */
+void GameBoard_make_move(GameBoard *board, int pit_to_play, GameBoardUndo *undo);
+void GameBoard_unmake_move(GameBoard *board, GameBoardUndo *undo);
+
 /**
  * Checks if the suggested play is a valid turn.
  */
 int GameBoard_is_valid_play(GameBoard *board, int pit_to_play);
 
+/**
+ * Checks if two boards hold the same position, whatever play led to them.
+ */
+int GameBoard_is_same_position(GameBoard *a, GameBoard *b);
+
+/**
+ * Counts the seeds in each lane again. Only needed after setting pits directly, as
+ * every play keeps the counts up to date itself.
+ */
+void GameBoard_update_totals(GameBoard *board);
+
 /**
  * Returns 1 if the game is over or 0 if not.
  *
@@ -91,7 +195,67 @@ int GameBoard_score_of(GameBoard *board, int player);
 int GameBoard_get_successors(GameBoard *board, GameBoard ***successors);
 
 /**
- * Returns the utility for the current player.
+ * Fills moves with the valid pits of the current player in pit order.
+ * Returns the number of valid pits. Entries after them, up to the board length,
+ * may be overwritten.
+ */
+int GameBoard_get_moves(GameBoard *board, int *moves);
+
+/**
+ * Returns the starting state of a random sequence for the functions below, mixed
+ * from any seed. Each thread should keep a state of its own.
+ */
+uint64_t GameBoard_seed_random(uint64_t seed);
+
+/**
+ * Plays a valid pit picked at random from the random state, which moves on, and
+ * returns the pit. The game must not be over.
+ */
+int GameBoard_play_random(GameBoard *board, uint64_t *random_state);
+
+/**
+ * Plays the board in place to the end of the game, every pit picked at random as
+ * GameBoard_play_random does, and returns player 0's score less player 1's.
+ *
+ * The same board and random state always play the same game. It plays each turn
+ * as GameBoard_play_turn does, which takes nearly all of its time, so it runs little
+ * faster than playing move by move.
+ */
+int GameBoard_playout(GameBoard *board, uint64_t *random_state);
+
+/**
+ * Returns a Zobrist-style hash of the pits, stores and player to play.
+ *
+ * Every (cell, seed count) pair has its own pseudo-random key and the hash is the
+ * XOR of the keys of every cell, so boards reached by different plays hash equally.
+ */
+uint64_t GameBoard_hash(GameBoard *board);
+
+/**
+ * Returns the pit played to reach this board or -1 if no play has been made.
+ */
+int GameBoard_move_made(GameBoard *board);
+
+/**
+ * Returns a cheap estimate of how promising the given play is, higher being better.
+ *
+ * Plays that end in the player's store and so earn another turn come first,
+ * followed by captures ranked by the seeds they take, then all other plays at 0.
+ * Assumes the input is a valid play (see `_is_valid_play`).
+ */
+int GameBoard_move_hint(GameBoard *board, int pit_to_play);
+
+/**
+ * Returns the utility for the given player.
+ *
+ * Once the game is over this is INT_MAX for a win, -INT_MAX for a loss and 0 for a
+ * tie. Until then it is a weighted sum of the seeds in the player's store and lane
+ * over their opponent's, and of the chains and best capture open to the player to
+ * play, counting against the given player when that is their opponent.
+ *
+ * The stores and lanes are kept counted as the board is played, but the chains and
+ * captures are not, so before the game is over it costs a GameBoard_move_hint of
+ * every pit, O(length).
  */
 int GameBoard_utility(GameBoard *board, int for_player);
 
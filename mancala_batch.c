@@ -0,0 +1,267 @@
+#include "mancala.h"
+#include "mancala_kernels.h"
+#include "mancala_batch.h"
+
+#include <string.h>
+
+_Static_assert(GAMEBOARD_BATCH_SIZE == 8 || GAMEBOARD_BATCH_SIZE == 16 || GAMEBOARD_BATCH_SIZE == 32, "a batch holds 8, 16 or 32 games");
+
+// Comparing rows gives a row of signed masks, all ones where true, read back as a row.
+#define _ROW(mask) ((GameBoardBatchRow) (mask))
+
+// The pit of the lane of the player to play in every game, or of the other player
+// with is_zero and is_one swapped.
+#define _OWN(batch, pit, is_zero, is_one) (((batch)->lanes[0][pit] & (is_zero)) | ((batch)->lanes[1][pit] & (is_one)))
+
+// Rows are only ever handled in place rather than passed to or returned from functions,
+// so that they need no vector registers where there are none.
+
+/**
+ * Checks if any game of a row is set.
+ */
+static inline int _GameBoardBatch_any(GameBoardBatchRow *row) {
+
+    for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+        if ((*row)[game]) {
+            return 1;
+        }
+    }
+
+    return 0;
+
+}
+
+/**
+ * Plays a pit in every game marked active, following _GameBoard_play_turn.
+ */
+static void _GameBoardBatch_play(GameBoardBatch *batch, GameBoardBatchRow *pits, GameBoardBatchRow *is_active) {
+
+    GameBoardBatchRow pit = *pits;
+    GameBoardBatchRow active = *is_active;
+
+    int length = batch->length;
+    int cycle_length = 2 * length + 1;
+
+    GameBoardBatchRow is_one = _ROW(batch->turn == 1);
+    GameBoardBatchRow is_zero = ~is_one;
+
+    // Empty the played pits.
+    GameBoardBatchRow seeds = { 0 };
+    for (int i = 0; i < length; i++) {
+
+        GameBoardBatchRow is_played = active & _ROW(pit == (seed_t) i);
+        seeds |= is_played & _OWN(batch, i, is_zero, is_one);
+        batch->lanes[0][i] &= ~(is_played & is_zero);
+        batch->lanes[1][i] &= ~(is_played & is_one);
+
+    }
+
+    // Full laps only come with large seed counts, so they are divided out game by game.
+    GameBoardBatchRow laps = { 0 };
+    GameBoardBatchRow rest = seeds;
+    GameBoardBatchRow has_laps = _ROW(seeds >= (seed_t) cycle_length);
+    if (_GameBoardBatch_any(&has_laps)) {
+        for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+            laps[game] = seeds[game] / cycle_length;
+            rest[game] = seeds[game] % cycle_length;
+        }
+    }
+
+    // Sow every position by its distance from the played pit, as _GameBoard_sow does.
+    // The opponent's pits follow the player's store, so they are length + 1 further on.
+    for (int player = 0; player < 2; player++) {
+
+        GameBoardBatchRow offset = (player == 0 ? is_one : is_zero) & (seed_t) (length + 1);
+        for (int i = 0; i < length; i++) {
+
+            // Positions before the pit wrap round below 0, then back up by a cycle.
+            GameBoardBatchRow distance = offset + (seed_t) i - pit - 1;
+            distance += _ROW(distance >= (seed_t) cycle_length) & (seed_t) cycle_length;
+            batch->lanes[player][i] += laps + (_ROW(distance < rest) & 1);
+
+        }
+
+    }
+
+    GameBoardBatchRow store_sown = laps + (_ROW((seed_t) (length - 1) - pit < rest) & 1);
+    batch->stores[0] += store_sown & is_zero;
+    batch->stores[1] += store_sown & is_one;
+
+    // Ending in their own store, the player takes another turn.
+    GameBoardBatchRow landed_at = pit + rest;
+    landed_at -= _ROW(landed_at >= (seed_t) cycle_length) & (seed_t) cycle_length;
+    GameBoardBatchRow is_chain = _ROW(landed_at == (seed_t) length);
+    batch->turn ^= active & ~is_chain & 1;
+
+    // Ending in an empty pit of their own, the player captures it along with the
+    // opposite pit, if that holds any seeds.
+    GameBoardBatchRow is_own_pit = active & _ROW(landed_at < (seed_t) length);
+    GameBoardBatchRow captured = { 0 };
+    for (int i = 0; i < length; i++) {
+
+        int opposite = length - i - 1;
+        GameBoardBatchRow opposite_seeds = _OWN(batch, opposite, is_one, is_zero);
+        GameBoardBatchRow is_capture = is_own_pit & _ROW(landed_at == (seed_t) i)
+            & _ROW(_OWN(batch, i, is_zero, is_one) == 1) & _ROW(opposite_seeds > 0);
+
+        // Only a single pit of each game can be the one landed in.
+        captured += is_capture & (opposite_seeds + 1);
+        batch->lanes[0][i] &= ~(is_capture & is_zero);
+        batch->lanes[1][i] &= ~(is_capture & is_one);
+        batch->lanes[0][opposite] &= ~(is_capture & is_one);
+        batch->lanes[1][opposite] &= ~(is_capture & is_zero);
+
+    }
+
+    batch->stores[0] += captured & is_zero;
+    batch->stores[1] += captured & is_one;
+
+}
+
+/**
+ * Marks every game that is over.
+ */
+static inline void _GameBoardBatch_game_over(GameBoardBatch *batch, GameBoardBatchRow *is_over) {
+
+    GameBoardBatchRow seeds_0 = { 0 };
+    GameBoardBatchRow seeds_1 = { 0 };
+    for (int i = 0; i < batch->length; i++) {
+        seeds_0 |= batch->lanes[0][i];
+        seeds_1 |= batch->lanes[1][i];
+    }
+
+    *is_over = _ROW(seeds_0 == 0) | _ROW(seeds_1 == 0);
+
+}
+
+void GameBoardBatch_setup(GameBoardBatch *batch, int length) {
+
+    memset(batch, 0, sizeof(GameBoardBatch));
+    batch->length = length;
+
+}
+
+void GameBoardBatch_set(GameBoardBatch *batch, int game, GameBoard *board) {
+
+    for (int player = 0; player < 2; player++) {
+
+        for (int i = 0; i < batch->length; i++) {
+            batch->lanes[player][i][game] = board->lanes[player][i];
+        }
+        batch->stores[player][game] = board->stores[player];
+
+    }
+
+    batch->turn[game] = board->turn;
+
+}
+
+void GameBoardBatch_get(GameBoardBatch *batch, int game, GameBoard *board) {
+
+    memset(board, 0, sizeof(GameBoard));
+    board->length = batch->length;
+    board->turn = batch->turn[game];
+
+    for (int player = 0; player < 2; player++) {
+
+        for (int i = 0; i < batch->length; i++) {
+            board->lanes[player][i] = batch->lanes[player][i][game];
+        }
+        board->stores[player] = batch->stores[player][game];
+
+    }
+    GameBoard_update_totals(board);
+
+    board->play_made.pit_played = -1;
+    board->play_made.turn = -1;
+    board->play_made.was_capture = -1;
+    board->play_made.was_chain = -1;
+
+}
+
+void GameBoardBatch_play_turn(GameBoardBatch *batch, int *pits) {
+
+    GameBoardBatchRow pit = { 0 };
+    GameBoardBatchRow active = { 0 };
+    for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+        pit[game] = pits[game] >= 0 ? pits[game] : 0;
+        active[game] = pits[game] >= 0 ? (seed_t) -1 : 0;
+    }
+
+    _GameBoardBatch_play(batch, &pit, &active);
+
+}
+
+uint32_t GameBoardBatch_is_game_over(GameBoardBatch *batch) {
+
+    GameBoardBatchRow is_over;
+    _GameBoardBatch_game_over(batch, &is_over);
+
+    uint32_t games_over = 0;
+    for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+        games_over |= (uint32_t) (is_over[game] & 1) << game;
+    }
+
+    return games_over;
+
+}
+
+void GameBoardBatch_playout(GameBoardBatch *batch, uint64_t *random_state, int *score_differences) {
+
+    int length = batch->length;
+
+    while (1) {
+
+        GameBoardBatchRow active;
+        _GameBoardBatch_game_over(batch, &active);
+        active = ~active;
+        if (!_GameBoardBatch_any(&active)) {
+            break;
+        }
+
+        GameBoardBatchRow is_one = _ROW(batch->turn == 1);
+        GameBoardBatchRow is_zero = ~is_one;
+
+        // A byte of randomness for every game, four games to a random number.
+        GameBoardBatchRow random;
+        for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game += 4) {
+
+            uint64_t bits = _GameBoard_random(random_state);
+            for (int i = 0; i < 4; i++) {
+                random[game + i] = (bits >> (16 * i + 8)) & 0xff;
+            }
+
+        }
+
+        // Scale the byte to the number of valid pits, then find that valid pit.
+        GameBoardBatchRow number_moves = { 0 };
+        for (int i = 0; i < length; i++) {
+            number_moves += _ROW(_OWN(batch, i, is_zero, is_one) > 0) & 1;
+        }
+
+        GameBoardBatchRow move = (random * number_moves) >> 8;
+        GameBoardBatchRow pit = { 0 };
+        GameBoardBatchRow moves_before = { 0 };
+        for (int i = 0; i < length; i++) {
+
+            GameBoardBatchRow is_valid = _ROW(_OWN(batch, i, is_zero, is_one) > 0);
+            pit |= is_valid & _ROW(moves_before == move) & (seed_t) i;
+            moves_before += is_valid & 1;
+
+        }
+
+        _GameBoardBatch_play(batch, &pit, &active);
+
+    }
+
+    for (int game = 0; game < GAMEBOARD_BATCH_SIZE; game++) {
+
+        int score_difference = batch->stores[0][game] - batch->stores[1][game];
+        for (int i = 0; i < length; i++) {
+            score_difference += batch->lanes[0][i][game] - batch->lanes[1][i][game];
+        }
+        score_differences[game] = score_difference;
+
+    }
+
+}
@@ -0,0 +1,86 @@
+/**
+ *
+ * This file describes a batch of Mancala games played side by side.
+ *
+ * A batch holds GAMEBOARD_BATCH_SIZE games of the same length as a structure of
+ * arrays: each pit, store and turn is a row holding that cell of every game. Every
+ * game of a batch is then played at once, a row at a time, with the same sowing,
+ * captures, chains and end of game as GameBoard_play_turn, worked out without
+ * branching on any single game.
+ *
+ * Rows are GCC vectors, so the same code compiles to AVX2 where it is enabled
+ * (e.g. with -mavx2 or -march=native), to SSE2 on any other x86-64 and to plain
+ * scalar code where there is no vector unit.
+ *
+ * Batches are only meant for playing many games quickly, so unlike a GameBoard
+ * they do not record the last play made.
+ *
+ */
+
+#include <stdint.h>
+
+// GameBoard comes from mancala.h, which must be included first.
+
+// The number of games in a batch, one of 8, 16 or 32. By default a row fills a
+// single vector register of the widest instruction set enabled, as rows wider than
+// a register are split up far less efficiently.
+#ifndef GAMEBOARD_BATCH_SIZE
+    #if defined(__AVX512BW__)
+        #define GAMEBOARD_BATCH_SIZE 32
+    #elif defined(__AVX2__)
+        #define GAMEBOARD_BATCH_SIZE 16
+    #else
+        #define GAMEBOARD_BATCH_SIZE 8
+    #endif
+#endif
+
+/**
+ * A cell of every game of a batch.
+ */
+typedef seed_t GameBoardBatchRow __attribute__ ((vector_size (GAMEBOARD_BATCH_SIZE * sizeof(seed_t))));
+
+/**
+ * A batch of games. Its rows must be aligned to their size, which they are on the
+ * stack, within other structs and from aligned_alloc.
+ */
+typedef struct {
+
+    int length;
+
+    GameBoardBatchRow lanes[2][GAMEBOARD_MAX_LENGTH];
+    GameBoardBatchRow stores[2];
+    GameBoardBatchRow turn;
+
+} GameBoardBatch;
+
+/**
+ * Empties every game of a batch of the given length. Empty games are over.
+ */
+void GameBoardBatch_setup(GameBoardBatch *batch, int length);
+
+/**
+ * Copies a board into a game of the batch and back out of it. The board must have
+ * the batch's length. Boards copied out have no play made.
+ */
+void GameBoardBatch_set(GameBoardBatch *batch, int game, GameBoard *board);
+void GameBoardBatch_get(GameBoardBatch *batch, int game, GameBoard *board);
+
+/**
+ * Plays a pit in every game at once, or nothing in games given a negative pit.
+ * Every other pit must be a valid play (see `GameBoard_is_valid_play`).
+ */
+void GameBoardBatch_play_turn(GameBoardBatch *batch, int *pits);
+
+/**
+ * Returns a mask with the bit of every game that is over set.
+ */
+uint32_t GameBoardBatch_is_game_over(GameBoardBatch *batch);
+
+/**
+ * Plays every game to the end in place, each valid pit picked at random, and fills
+ * in player 0's score less player 1's for every game.
+ *
+ * The random state moves on as GameBoard_playout's does, though the pits it picks
+ * are not the same. The same batch and random state always play the same games.
+ */
+void GameBoardBatch_playout(GameBoardBatch *batch, uint64_t *random_state, int *score_differences);
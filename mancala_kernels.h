@@ -0,0 +1,451 @@
+/**
+ *
+ * This file holds the kernels of the GameBoard, shared by mancala.c and the search
+ * instantiated for the GameBoard in mancala_search.c so that it can inline them.
+ *
+ * Every kernel takes the board length as an argument, see GAMEBOARD_WITH_LENGTH.
+ * Include it after mancala.h, and only from the files implementing the GameBoard.
+ *
+ */
+
+
+#include <limits.h>
+#include <stdint.h>
+
+/**
+ * Runs a statement with `length` bound to the board's length.
+ *
+ * The kernels below take the length as an argument. For the most common lengths it
+ * is bound to a constant, so each gets its own copy of the kernels it calls with
+ * every loop bound and modulus known when compiled. Any other length runs the same
+ * kernels generically.
+ */
+#if GAMEBOARD_MAX_LENGTH >= 6
+    #define _GAMEBOARD_CASE_6(statement) case 6: { const int length = 6; statement; } break;
+#else
+    #define _GAMEBOARD_CASE_6(statement)
+#endif
+
+#if GAMEBOARD_MAX_LENGTH >= 7
+    #define _GAMEBOARD_CASE_7(statement) case 7: { const int length = 7; statement; } break;
+#else
+    #define _GAMEBOARD_CASE_7(statement)
+#endif
+
+#define GAMEBOARD_WITH_LENGTH(board, statement) \
+    switch ((board)->length) { \
+        _GAMEBOARD_CASE_6(statement) \
+        _GAMEBOARD_CASE_7(statement) \
+        default: { const int length = (board)->length; statement; } break; \
+    }
+
+/**
+ * Sows seeds from a pit of the given player, one into each following pit and the
+ * player's own store in turn, skipping the opponent's store. With a sign of -1 the
+ * same seeds are taken back instead. The played pit itself is left to the caller,
+ * while the totals of both lanes are kept up to date.
+ *
+ * Returns where the last seed lands, counting the player's pits from 0, then their
+ * store at length and then the opponent's pits.
+ */
+static inline int _GameBoard_sow(GameBoard *board, int length, int turn, int pit, int seeds, int sign) {
+
+    int cycle_length = 2 * length + 1;
+
+    seed_t *own_lane = board->lanes[turn];
+    seed_t *other_lane = board->lanes[turn ^ 1];
+
+    // Every full lap adds the same to each pit, the played one included, and to the
+    // store. Seeds wrap like any unsigned value, so taking them back is adding -laps.
+    int laps = seeds / cycle_length;
+    if (laps > 0) {
+
+        seed_t lap_seeds = sign * laps;
+        for (int i = 0; i < length; i++) {
+            own_lane[i] += lap_seeds;
+            other_lane[i] += lap_seeds;
+        }
+        board->stores[turn] += lap_seeds;
+
+    }
+
+    // The rest fill the positions after the pit, wrapping round at most once. Each
+    // position takes a seed if it is close enough to the pit, so that no branch
+    // depends on how many seeds there are.
+    int rest = seeds % cycle_length;
+
+    for (int i = 0; i < length; i++) {
+        int distance = i - pit - 1;
+        distance += distance < 0 ? cycle_length : 0;
+        own_lane[i] += sign * (distance < rest);
+    }
+
+    int store_sown = length - pit - 1 < rest;
+    board->stores[turn] += sign * store_sown;
+
+    for (int i = 0; i < length; i++) {
+        other_lane[i] += sign * (length - pit + i < rest);
+    }
+
+    // The opponent's lane starts length - pit positions on, and its pits take the
+    // rest in turn. The player's own lane takes whatever the store and it do not.
+    int other_sown = rest - (length - pit);
+    other_sown = other_sown < 0 ? 0 : (other_sown > length ? length : other_sown);
+    board->totals[turn ^ 1] += sign * (laps * length + other_sown);
+    board->totals[turn] += sign * (laps * length + rest - store_sown - other_sown);
+
+    return (pit + seeds) % cycle_length;
+
+}
+
+
+/**
+ * Plays a turn and reports how many seeds were taken from the opponent by a capture.
+ */
+static inline int _GameBoard_play_turn(GameBoard *board, int length, int pit_to_play, seed_t *seeds_captured) {
+
+    // Constraints:
+    //  * pit_to_play < length
+    //  * board->lane_(board->turn) > 0
+
+    // Record this play.
+    board->play_made.pit_played = pit_to_play;
+    board->play_made.turn = board->turn;
+    board->play_made.was_capture = 0;
+    board->play_made.was_chain = 0;
+
+    int starting_turn = board->turn;
+    *seeds_captured = 0;
+
+    seed_t *playing_lane = board->lanes[starting_turn];
+    seed_t *playing_store = &(board->stores[starting_turn]);
+
+    // Empty the played pit and distribute its seeds into the next pits.
+    int seeds = playing_lane[pit_to_play];
+    playing_lane[pit_to_play] = 0;
+    board->totals[starting_turn] -= seeds;
+
+    int landed_at = _GameBoard_sow(board, length, starting_turn, pit_to_play, seeds, 1);
+
+    // Check for end-of-turn conditions.
+    if (landed_at == length) {
+        // Ended in own store. The player takes another turn.
+        board->play_made.was_chain = 1;
+    } else {
+        board->turn ^= 1;
+    }
+
+    if (landed_at < length) {
+
+        int landed_in_pit_index = landed_at;
+        int landed_in_pit = playing_lane[landed_in_pit_index];
+        int opponents_turn = starting_turn ^ 1;
+        int adjacent_pit_index = length - landed_in_pit_index - 1;
+        int adjacent_pit = board->lanes[opponents_turn][adjacent_pit_index];
+
+        if (adjacent_pit > 0 && landed_in_pit == 1) {
+
+            board->lanes[opponents_turn][adjacent_pit_index] = 0;
+            playing_lane[landed_in_pit_index] = 0;
+            (*playing_store) += adjacent_pit + 1;
+            board->totals[opponents_turn] -= adjacent_pit;
+            board->totals[starting_turn] -= 1;
+
+            board->play_made.was_capture = 1;
+            *seeds_captured = adjacent_pit;
+
+        }
+
+    }
+
+    return board->turn;
+
+}
+
+
+static inline void _GameBoard_make_move(GameBoard *board, int length, int pit_to_play, GameBoardUndo *undo) {
+
+    undo->pit_played = pit_to_play;
+    undo->turn = board->turn;
+    undo->seeds_sown = board->lanes[board->turn][pit_to_play];
+    undo->previous_play = board->play_made;
+
+    _GameBoard_play_turn(board, length, pit_to_play, &(undo->seeds_captured));
+
+}
+
+static inline void _GameBoard_unmake_move(GameBoard *board, int length, GameBoardUndo *undo) {
+
+    int starting_turn = undo->turn;
+    int opponents_turn = starting_turn ^ 1;
+
+    seed_t *playing_lane = board->lanes[starting_turn];
+    seed_t *playing_store = &(board->stores[starting_turn]);
+
+    // Give back a capture first so the sowing below sees the pits as they were sown.
+    if (undo->seeds_captured > 0) {
+
+        // A capture only happens when the last seed lands in the players own lane.
+        int cycle_length = 2 * length + 1;
+        int landed_in_pit_index = (undo->pit_played + undo->seeds_sown) % cycle_length;
+        int adjacent_pit_index = length - landed_in_pit_index - 1;
+
+        board->lanes[opponents_turn][adjacent_pit_index] = undo->seeds_captured;
+        playing_lane[landed_in_pit_index] = 1;
+        (*playing_store) -= undo->seeds_captured + 1;
+        board->totals[opponents_turn] += undo->seeds_captured;
+        board->totals[starting_turn] += 1;
+
+    }
+
+    // Take back the seeds sown, including those the laps left in the played pit.
+    _GameBoard_sow(board, length, starting_turn, undo->pit_played, undo->seeds_sown, -1);
+
+    board->lanes[starting_turn][undo->pit_played] = undo->seeds_sown;
+    board->totals[starting_turn] += undo->seeds_sown;
+    board->turn = starting_turn;
+    board->play_made = undo->previous_play;
+
+}
+
+
+static inline int _GameBoard_is_game_over(GameBoard *board, int length) {
+
+    return board->totals[0] == 0 || board->totals[1] == 0;
+
+}
+
+
+static inline int _GameBoard_score_of(GameBoard *board, int length, int player) {
+
+    return board->stores[player] + board->totals[player];
+
+}
+
+
+static inline int _GameBoard_winner_is(GameBoard *board, int length) {
+
+    int score_0 = _GameBoard_score_of(board, length, 0);
+    int score_1 = _GameBoard_score_of(board, length, 1);
+
+    if (score_0 > score_1) {
+        // Player 0 won.
+        return 0;
+    }
+
+    if (score_0 == score_1) {
+        // Tie.
+        return -1;
+    }
+
+    // Player 1 won.
+    return 1;
+
+}
+
+
+static inline int _GameBoard_get_moves(GameBoard *board, int length, int *moves) {
+
+    seed_t *playing_lane = board->lanes[board->turn];
+
+    int number_moves = 0;
+    for (int i = 0; i < length; i++) {
+        moves[number_moves] = i;
+        number_moves += playing_lane[i] > 0;
+    }
+
+    return number_moves;
+
+}
+
+
+/**
+ * Returns the next number from a xorshift64 sequence, which must never be 0.
+ */
+static inline uint64_t _GameBoard_random(uint64_t *state) {
+
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+
+}
+
+
+/**
+ * Plays a valid pit picked at random, scaling the top bits of the next random number
+ * to the number of valid pits rather than dividing by it.
+ *
+ * The valid pits are listed without a branch, which is no slower than picking the
+ * set bit of a mask of them, and faster where popcount is not an instruction.
+ */
+static inline int _GameBoard_play_random(GameBoard *board, int length, uint64_t *random_state) {
+
+    int moves[GAMEBOARD_MAX_LENGTH];
+    int number_moves = _GameBoard_get_moves(board, length, moves);
+    int pit_to_play = moves[((_GameBoard_random(random_state) >> 32) * number_moves) >> 32];
+
+    seed_t seeds_captured;
+    _GameBoard_play_turn(board, length, pit_to_play, &seeds_captured);
+
+    return pit_to_play;
+
+}
+
+
+static inline int _GameBoard_playout(GameBoard *board, int length, uint64_t *random_state) {
+
+    while (!_GameBoard_is_game_over(board, length)) {
+        _GameBoard_play_random(board, length, random_state);
+    }
+
+    return _GameBoard_score_of(board, length, 0) - _GameBoard_score_of(board, length, 1);
+
+}
+
+
+/**
+ * Mixes a 64 bit value so that every input bit affects every output bit (splitmix64).
+ */
+static inline uint64_t _GameBoard_mix(uint64_t value) {
+
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+
+}
+
+
+/**
+ * Returns the key for a cell holding the given number of seeds.
+ * Cells are numbered with player 0's pits first, then player 1's, then the two stores.
+ */
+static inline uint64_t _GameBoard_zobrist_key(int cell, int seeds) {
+    return _GameBoard_mix(((uint64_t) cell << 32) | seeds);
+}
+
+
+static inline uint64_t _GameBoard_hash(GameBoard *board, int length) {
+
+    uint64_t hash = 0;
+
+    for (int i = 0; i < length; i++) {
+        hash ^= _GameBoard_zobrist_key(i, board->lanes[0][i]);
+        hash ^= _GameBoard_zobrist_key(GAMEBOARD_MAX_LENGTH + i, board->lanes[1][i]);
+    }
+
+    hash ^= _GameBoard_zobrist_key(2 * GAMEBOARD_MAX_LENGTH, board->stores[0]);
+    hash ^= _GameBoard_zobrist_key(2 * GAMEBOARD_MAX_LENGTH + 1, board->stores[1]);
+
+    if (board->turn == 1) {
+        hash ^= _GameBoard_zobrist_key(2 * GAMEBOARD_MAX_LENGTH + 2, 0);
+    }
+
+    return hash;
+
+}
+
+
+// The move hint of a play ending in the player's store, above any capture's.
+#define _GAMEBOARD_HINT_CHAIN (1 << 17)
+
+static inline int _GameBoard_move_hint(GameBoard *board, int length, int pit_to_play) {
+
+    int seeds = board->lanes[board->turn][pit_to_play];
+    int cycle_length = 2 * length + 1;
+
+    // Positions around the board from the player's first pit: their pits, their store,
+    // then the opponent's pits.
+    int landed_in = (pit_to_play + seeds) % cycle_length;
+
+    // Ended in own store.
+    // This outranks any capture as a capture takes at most every seed on the board.
+    if (landed_in == length) {
+        return _GAMEBOARD_HINT_CHAIN;
+    }
+
+    // A capture needs the last seed to land alone in one of the player's own pits.
+    // Only short sowings are predicted, a full lap refills every pit.
+    int opponents_turn = board->turn ^ 1;
+    if (seeds < cycle_length && landed_in < length && landed_in != pit_to_play
+            && board->lanes[board->turn][landed_in] == 0) {
+
+        // Sowing past the store also drops seeds into the opponent's lane.
+        int adjacent_pit_index = length - landed_in - 1;
+        int adjacent_pit = board->lanes[opponents_turn][adjacent_pit_index];
+        if (landed_in < pit_to_play) {
+            adjacent_pit++;
+        }
+
+        if (adjacent_pit > 0) {
+            return 1 + adjacent_pit;
+        }
+
+    }
+
+    return 0;
+
+}
+
+
+static inline int _GameBoard_utility(GameBoard *board, int length, int for_player) {
+
+    // If the game is over, this is the best (or worst) possible move.
+    if (_GameBoard_is_game_over(board, length)) {
+
+        int winner = _GameBoard_winner_is(board, length);
+
+        // Tie.
+        if (winner == -1) {
+            return 0;
+        }
+
+        if (winner == for_player) {
+            return INT_MAX;
+        }
+
+        // Loser, as low as a winner is high.
+        return -INT_MAX;
+    }
+
+    // We will calculate many different heuristics and take a weighted sum of them.
+    // The seeds in the stores and lanes are kept counted, so only the plays open to
+    // the player to play need to be looked at.
+    int other_player = for_player ^ 1;
+    int utility = GAMEBOARD_WEIGHT_STORES * (board->stores[for_player] - board->stores[other_player])
+        + GAMEBOARD_WEIGHT_LANES * (board->totals[for_player] - board->totals[other_player]);
+
+    // Every chain counts, but only the best capture, as the others may not survive it.
+    int chains = 0;
+    int best_capture = 0;
+    for (int i = 0; i < length; i++) {
+
+        int hint = _GameBoard_move_hint(board, length, i);
+        int is_chain = hint == _GAMEBOARD_HINT_CHAIN;
+        chains += is_chain;
+        if (!is_chain && hint > best_capture) {
+            best_capture = hint;
+        }
+
+    }
+
+    int threats = GAMEBOARD_WEIGHT_CHAINS * chains + GAMEBOARD_WEIGHT_CAPTURES * best_capture;
+    utility += board->turn == for_player ? threats : -threats;
+
+    return utility;
+
+}
+
+
+static inline int _GameBoard_is_dead_state(GameBoard *board, int length, int for_player) {
+
+    int seeds_left = board->totals[0] + board->totals[1];
+
+    int possible_score = board->stores[for_player] + seeds_left;
+    return possible_score < board->stores[for_player ^ 1];
+
+}
+
@@ -0,0 +1,80 @@
+#include "mancala.h"
+#include "mancala_kernels.h"
+#include "gametree.h"
+#include "gametree_internal.h"
+#include "mancala_search.h"
+
+// Every instance searches in place, calling the kernels for the length it is made for.
+#define MINMAXSEARCH_IS_IN_PLACE(search) 1
+#define MINMAXSEARCH_UTILITY(search, state, for_player) _GameBoard_utility((state), GAMEBOARD_SEARCH_LENGTH(state), (for_player))
+#define MINMAXSEARCH_IS_TERMINAL(search, state) _GameBoard_is_game_over((state), GAMEBOARD_SEARCH_LENGTH(state))
+#define MINMAXSEARCH_GET_TURN(search, state) (((GameBoard *) (state))->turn)
+#define MINMAXSEARCH_IS_DEAD_STATE(search, state, for_player) _GameBoard_is_dead_state((state), GAMEBOARD_SEARCH_LENGTH(state), (for_player))
+#define MINMAXSEARCH_GET_MOVES(search, state, moves) _GameBoard_get_moves((state), GAMEBOARD_SEARCH_LENGTH(state), (moves))
+#define MINMAXSEARCH_MAKE_MOVE(search, state, move, undo) _GameBoard_make_move((state), GAMEBOARD_SEARCH_LENGTH(state), (move), (undo))
+#define MINMAXSEARCH_UNMAKE_MOVE(search, state, undo) _GameBoard_unmake_move((state), GAMEBOARD_SEARCH_LENGTH(state), (undo))
+#define MINMAXSEARCH_MOVE_HINT(search, state, move) _GameBoard_move_hint((state), GAMEBOARD_SEARCH_LENGTH(state), (move))
+#define MINMAXSEARCH_HASH(search, state) _GameBoard_hash((state), GAMEBOARD_SEARCH_LENGTH(state))
+
+// The same lengths as GAMEBOARD_WITH_LENGTH.
+#if GAMEBOARD_MAX_LENGTH >= 6
+    #define GAMEBOARD_SEARCH_LENGTH(board) 6
+    #define MINMAXSEARCH_NAME(name) name##_6
+    #include "gametree_search.h"
+    #undef GAMEBOARD_SEARCH_LENGTH
+#endif
+
+#if GAMEBOARD_MAX_LENGTH >= 7
+    #define GAMEBOARD_SEARCH_LENGTH(board) 7
+    #define MINMAXSEARCH_NAME(name) name##_7
+    #include "gametree_search.h"
+    #undef GAMEBOARD_SEARCH_LENGTH
+#endif
+
+#define GAMEBOARD_SEARCH_LENGTH(board) (((GameBoard *) (board))->length)
+#define MINMAXSEARCH_NAME(name) name##_any
+#include "gametree_search.h"
+#undef GAMEBOARD_SEARCH_LENGTH
+
+void GameBoard_setup_search(MinMaxSearch *search) {
+
+    search->utility = (int (*) (void *, int)) &GameBoard_utility;
+    search->is_terminal = (int (*) (void *)) &GameBoard_is_game_over;
+    search->get_turn = (int (*) (void *)) &GameBoard_current_turn;
+    search->get_successors = (int (*) (void *, void ***)) &GameBoard_get_successors;
+    search->free_state = (void (*) (void *)) &GameBoard_delete;
+    search->is_dead_state = (int (*) (void *, int)) &GameBoard_is_dead_state;
+
+    // Search below the root on a single board in place.
+    search->get_moves = (int (*) (void *, int *)) &GameBoard_get_moves;
+    search->make_move = (void (*) (void *, int, void *)) &GameBoard_make_move;
+    search->unmake_move = (void (*) (void *, void *)) &GameBoard_unmake_move;
+    search->undo_size = sizeof(GameBoardUndo);
+    search->copy_state = (void *(*) (void *)) &GameBoard_copy;
+
+    // Order moves with chains and captures first.
+    search->get_move_made = (int (*) (void *)) &GameBoard_move_made;
+    search->move_hint = (int (*) (void *, int)) &GameBoard_move_hint;
+
+    search->hash = (uint64_t (*) (void *)) &GameBoard_hash;
+
+    search->search_node = &GameBoard_search_node;
+
+}
+
+int GameBoard_search_node(MinMaxSearch *search, Node *root, int player, int depth, int alpha, int beta) {
+
+    switch (((GameBoard *) root->game_state)->length) {
+#if GAMEBOARD_MAX_LENGTH >= 6
+        case 6:
+            return _MinMaxSearch_search_inner_6(search, root, player, depth, alpha, beta);
+#endif
+#if GAMEBOARD_MAX_LENGTH >= 7
+        case 7:
+            return _MinMaxSearch_search_inner_7(search, root, player, depth, alpha, beta);
+#endif
+        default:
+            return _MinMaxSearch_search_inner_any(search, root, player, depth, alpha, beta);
+    }
+
+}
@@ -0,0 +1,26 @@
+/**
+ *
+ * This file describes the search specialized for the GameBoard.
+ *
+ * The search below the root is instantiated from gametree_search.h with direct calls
+ * to the GameBoard's kernels, once for each specialized board length and once for
+ * any other, so that no game function is called through a pointer.
+ *
+ */
+
+// GameBoard and MinMaxSearch come from mancala.h and gametree.h, which must be included first.
+
+/**
+ * Sets every game function of the search to the GameBoard's, searching in place, and
+ * sets search_node to GameBoard_search_node.
+ *
+ * Clearing search_node afterwards searches through the function pointers instead.
+ */
+void GameBoard_setup_search(MinMaxSearch *search);
+
+/**
+ * Searches a node below the root, calling the GameBoard directly.
+ *
+ * Assumes the search was set up to search in place (see `GameBoard_setup_search`).
+ */
+int GameBoard_search_node(MinMaxSearch *search, Node *root, int player, int depth, int alpha, int beta);
@@ -0,0 +1,448 @@
+#include "mcts.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The tree shared by every thread of a search.
+ */
+typedef struct {
+
+    MCTSSearch *search;
+
+    // The undo record of each ply of a playout starts this far after the last, the
+    // search's undo_size rounded up so that every record is aligned.
+    size_t undo_stride;
+
+    // The pool every node comes from, the root first.
+    MCTSNode *nodes;
+    long long number_nodes;
+    int is_full;
+
+    // Claimed by each thread before it plays out, to keep to the playout budget.
+    long long playouts_started;
+
+    // Set once the search is out of time, so that every thread stops.
+    int is_done;
+    long long deadline_ns;
+
+} _MCTSTree;
+
+_Static_assert(MCTS_MAX_UNDO_SIZE % _Alignof(max_align_t) == 0, "aligned undo records of MCTS_MAX_UNDO_SIZE must fit every ply");
+
+/**
+ * A thread taking part in a search, with a state of its own.
+ */
+typedef struct {
+
+    _MCTSTree *tree;
+    pthread_t thread;
+
+    void *state;
+    _Alignas(max_align_t) char undo[MCTS_MAX_PLAYOUT_PLIES * MCTS_MAX_UNDO_SIZE]; // A record of every move of a playout.
+    uint64_t random_state;
+
+    // The nodes the current playout passed through, the root first.
+    MCTSNode *path[MCTS_MAX_PLAYOUT_PLIES + 1];
+
+    long long playouts;
+    int max_depth;
+
+} _MCTSWorker;
+
+static inline long long _now_ns() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+
+}
+
+/**
+ * Returns the next number from a xorshift64 sequence.
+ */
+static inline uint64_t _MCTS_random(uint64_t *state) {
+
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+
+}
+
+/**
+ * Returns the starting state of the random sequence of a thread, mixing the seed
+ * with splitmix64 so that neighbouring threads start far apart.
+ */
+static uint64_t _MCTS_seed(uint64_t seed, int thread) {
+
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL * (uint64_t) (thread + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    // A xorshift sequence never leaves 0.
+    return z != 0 ? z : 1;
+
+}
+
+/**
+ * Takes nodes side by side from the pool, or returns NULL once it is full.
+ */
+static MCTSNode *_MCTSTree_allocate(_MCTSTree *tree, int number_nodes) {
+
+    long long first = __atomic_fetch_add(&(tree->number_nodes), number_nodes, __ATOMIC_RELAXED);
+    if (first + number_nodes > tree->search->options.max_nodes) {
+        __atomic_store_n(&(tree->is_full), 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    return tree->nodes + first;
+
+}
+
+/**
+ * Adds the children of a node, reached by the given state.
+ *
+ * Returns 0, leaving the node as it was, if another thread is adding them already
+ * or the pool is full.
+ */
+static int _MCTSTree_expand(_MCTSTree *tree, MCTSNode *node, void *state) {
+
+    MCTSSearch *search = tree->search;
+
+    int unexpanded = 0;
+    if (__atomic_load_n(&(tree->is_full), __ATOMIC_RELAXED) ||
+        !__atomic_compare_exchange_n(&(node->expansion), &unexpanded, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    int moves[MCTS_MAX_MOVES];
+    int number_moves = search->is_terminal(state) ? 0 : search->get_moves(state, moves);
+
+    MCTSNode *children = NULL;
+    if (number_moves > 0) {
+
+        children = _MCTSTree_allocate(tree, number_moves);
+        if (children == NULL) {
+            __atomic_store_n(&(node->expansion), 0, __ATOMIC_RELEASE);
+            return 0;
+        }
+
+        int player = search->get_turn(state);
+        for (int i = 0; i < number_moves; i++) {
+
+            MCTSNode *child = children + i;
+            child->move = moves[i];
+            child->player = player;
+            child->expansion = 0;
+            child->number_children = 0;
+            child->children = NULL;
+            child->visits = 0;
+            child->reward = 0;
+
+        }
+
+    }
+
+    // Other threads only look at the children once they see the node expanded.
+    node->children = children;
+    node->number_children = number_moves;
+    __atomic_store_n(&(node->expansion), 2, __ATOMIC_RELEASE);
+
+    return 1;
+
+}
+
+/**
+ * Returns the child of an expanded node with the highest upper confidence bound,
+ * or the first child never visited.
+ */
+static MCTSNode *_MCTSNode_select(MCTSNode *node, double exploration) {
+
+    long long visits = __atomic_load_n(&(node->visits), __ATOMIC_RELAXED);
+    double log_visits = log(visits > 1 ? (double) visits : 1.0);
+
+    MCTSNode *best_child = node->children;
+    double best_bound = -1.0;
+    for (int i = 0; i < node->number_children; i++) {
+
+        MCTSNode *child = node->children + i;
+        long long child_visits = __atomic_load_n(&(child->visits), __ATOMIC_RELAXED);
+        if (child_visits == 0) {
+            return child;
+        }
+
+        long long reward = __atomic_load_n(&(child->reward), __ATOMIC_RELAXED);
+        double bound = reward / (2.0 * child_visits) + exploration * sqrt(log_visits / child_visits);
+        if (bound > best_bound) {
+            best_bound = bound;
+            best_child = child;
+        }
+
+    }
+
+    return best_child;
+
+}
+
+/**
+ * Runs a single playout: down the tree, adding a node at its edge, then on to the
+ * end of the game with random moves, counting the result in every node passed.
+ */
+static void _MCTSWorker_playout(_MCTSWorker *worker) {
+
+    _MCTSTree *tree = worker->tree;
+    MCTSSearch *search = tree->search;
+    void *state = worker->state;
+    int virtual_loss = search->options.virtual_loss;
+
+    MCTSNode *node = tree->nodes;
+    __atomic_fetch_add(&(node->visits), virtual_loss, __ATOMIC_RELAXED);
+    worker->path[0] = node;
+
+    int depth = 0;
+    int plies = 0;
+    while (plies < MCTS_MAX_PLAYOUT_PLIES) {
+
+        // Stop at the first node not expanded, adding its children if no other thread is.
+        int is_new = 0;
+        if (__atomic_load_n(&(node->expansion), __ATOMIC_ACQUIRE) != 2) {
+            is_new = _MCTSTree_expand(tree, node, state);
+            if (!is_new) {
+                break;
+            }
+        }
+
+        if (node->number_children == 0) {
+            break;
+        }
+
+        node = _MCTSNode_select(node, search->options.exploration);
+        search->make_move(state, node->move, worker->undo + plies * tree->undo_stride);
+        plies++;
+
+        __atomic_fetch_add(&(node->visits), virtual_loss, __ATOMIC_RELAXED);
+        worker->path[++depth] = node;
+
+        if (is_new) {
+            break;
+        }
+
+    }
+
+    if (depth > worker->max_depth) {
+        worker->max_depth = depth;
+    }
+
+    // Play the rest of the game out at random, by the game itself if it can.
+    int utility;
+    if (search->playout != NULL) {
+
+        utility = search->playout(state, &(worker->random_state));
+
+    } else {
+
+        int moves[MCTS_MAX_MOVES];
+        while (plies < MCTS_MAX_PLAYOUT_PLIES && !search->is_terminal(state)) {
+
+            int number_moves = search->get_moves(state, moves);
+            int move = moves[_MCTS_random(&(worker->random_state)) % number_moves];
+            search->make_move(state, move, worker->undo + plies * tree->undo_stride);
+            plies++;
+
+        }
+
+        utility = search->utility(state, 0);
+
+    }
+    int winner = utility > 0 ? 0 : (utility < 0 ? 1 : -1);
+
+    // Count the playout, taking back its virtual losses.
+    for (int i = 0; i <= depth; i++) {
+
+        MCTSNode *passed = worker->path[i];
+        int reward = passed->player == winner ? 2 : (winner == -1 ? 1 : 0);
+        __atomic_fetch_add(&(passed->visits), 1 - virtual_loss, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&(passed->reward), reward, __ATOMIC_RELAXED);
+
+    }
+
+    // Return to the root.
+    while (plies > 0) {
+        plies--;
+        search->unmake_move(state, worker->undo + plies * tree->undo_stride);
+    }
+
+    worker->playouts++;
+
+}
+
+/**
+ * Checks if the search must stop, either out of time or told to.
+ */
+static inline int _MCTSTree_is_stopped(_MCTSTree *tree) {
+
+    MCTSSearch *search = tree->search;
+
+    int is_stopped = search->stop != NULL && __atomic_load_n(search->stop, __ATOMIC_RELAXED);
+    int is_late = tree->deadline_ns != 0 && _now_ns() >= tree->deadline_ns;
+
+    return is_stopped || is_late;
+
+}
+
+/**
+ * The loop of every thread of a search, playing out until the budget is spent.
+ */
+static void *_MCTSWorker_run(void *argument) {
+
+    _MCTSWorker *worker = argument;
+    _MCTSTree *tree = worker->tree;
+    MCTSSearch *search = tree->search;
+
+    while (!__atomic_load_n(&(tree->is_done), __ATOMIC_RELAXED)) {
+
+        if (worker->playouts % MCTS_TIME_CHECK_INTERVAL == 0 && _MCTSTree_is_stopped(tree)) {
+            __atomic_store_n(&(tree->is_done), 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+        if (search->options.max_playouts >= 0 &&
+            __atomic_fetch_add(&(tree->playouts_started), 1, __ATOMIC_RELAXED) >= search->options.max_playouts) {
+            break;
+        }
+
+        _MCTSWorker_playout(worker);
+
+    }
+
+    return NULL;
+
+}
+
+int MCTSSearch_search(MCTSSearch *search, void *state) {
+
+    long long start_ns = _now_ns();
+
+    search->best_move = -1;
+    search->best_win_rate = 0.0;
+    memset(&(search->stats), 0, sizeof(search->stats));
+
+    if (search->undo_size > MCTS_MAX_UNDO_SIZE) {
+        return -1;
+    }
+
+    // Every thread but the calling one plays on a copy of the state.
+    int number_threads = search->options.threads > 1 && search->copy_state != NULL ? search->options.threads : 1;
+
+    _MCTSTree tree;
+    memset(&tree, 0, sizeof(_MCTSTree));
+    tree.search = search;
+    tree.undo_stride = (search->undo_size + _Alignof(max_align_t) - 1) / _Alignof(max_align_t) * _Alignof(max_align_t);
+    tree.nodes = malloc(sizeof(MCTSNode) * (search->options.max_nodes > 1 ? search->options.max_nodes : 1));
+    if (tree.nodes == NULL) {
+        return -1;
+    }
+
+    if (search->options.time_limit_in_ms >= 0) {
+        tree.deadline_ns = start_ns + search->options.time_limit_in_ms * 1000000LL;
+    }
+
+    MCTSNode *root = _MCTSTree_allocate(&tree, 1);
+    root->move = -1;
+    root->player = -1;
+    root->expansion = 0;
+    root->number_children = 0;
+    root->children = NULL;
+    root->visits = 0;
+    root->reward = 0;
+
+    // The root always has its children, so there is a move to make whatever the budget.
+    if (!_MCTSTree_expand(&tree, root, state) || root->number_children == 0) {
+        free(tree.nodes);
+        return -1;
+    }
+
+    _MCTSWorker *workers = calloc(number_threads, sizeof(_MCTSWorker));
+    if (workers == NULL) {
+        free(tree.nodes);
+        return -1;
+    }
+
+    for (int i = 0; i < number_threads; i++) {
+
+        _MCTSWorker *worker = workers + i;
+        worker->tree = &tree;
+        worker->state = i == 0 ? state : search->copy_state(state);
+        worker->random_state = _MCTS_seed(search->options.seed, i);
+
+        // Search with as many threads as there are states to play on.
+        if (worker->state == NULL) {
+            number_threads = i;
+            break;
+        }
+
+    }
+
+    for (int i = 1; i < number_threads; i++) {
+        pthread_create(&(workers[i].thread), NULL, &_MCTSWorker_run, workers + i);
+    }
+    _MCTSWorker_run(workers);
+
+    for (int i = 1; i < number_threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    // Play the move visited most, the one the search is surest of.
+    MCTSNode *best_child = root->children;
+    for (int i = 1; i < root->number_children; i++) {
+        if (root->children[i].visits > best_child->visits) {
+            best_child = root->children + i;
+        }
+    }
+
+    search->best_move = best_child->move;
+    search->best_win_rate = best_child->visits > 0 ? best_child->reward / (2.0 * best_child->visits) : 0.0;
+
+    for (int i = 0; i < number_threads; i++) {
+
+        _MCTSWorker *worker = workers + i;
+        search->stats.playouts += worker->playouts;
+        if (worker->max_depth > search->stats.max_depth) {
+            search->stats.max_depth = worker->max_depth;
+        }
+
+        if (i > 0) {
+            search->free_state(worker->state);
+        }
+
+    }
+
+    search->stats.nodes = tree.number_nodes < search->options.max_nodes ? tree.number_nodes : search->options.max_nodes;
+    search->stats.threads = number_threads;
+    search->stats.elapsed_time_ms = (_now_ns() - start_ns) / 1000000;
+
+    free(workers);
+    free(tree.nodes);
+
+    return search->best_move;
+
+}
+
+void MCTSSearch_print_stats(MCTSSearch *search) {
+
+    printf(
+        "Monte Carlo search: %lld playouts on %d threads in %lldms, %lld nodes, %d plies deep.\n",
+        search->stats.playouts, search->stats.threads, search->stats.elapsed_time_ms,
+        search->stats.nodes, search->stats.max_depth
+    );
+    printf("Best move %d won %.1f%% of its playouts.\n", search->best_move, 100.0 * search->best_win_rate);
+
+}
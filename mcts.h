@@ -0,0 +1,137 @@
+/**
+ *
+ * This file describes a Monte Carlo tree search.
+ *
+ * Rather than searching every move to a fixed depth, the search grows a tree one
+ * node at a time towards the moves that have won most often so far (UCT), plays the
+ * game out with random moves from each new node and counts the result along the way
+ * back to the root. It works with any budget of time or playouts, so it stays useful
+ * where the branching factor and length of the game make a fixed depth too shallow.
+ *
+ * The game is played with the same in place functions as a MinMaxSearch, on a single
+ * state per thread that every playout returns to the root by undoing its moves. A game
+ * may also play out from a node in a single call of its own.
+ *
+ * Nodes come from a pool allocated once for the whole search, the children of a node
+ * side by side, so growing the tree never calls the allocator. Once the pool is full
+ * the tree stops growing and playouts carry on from its leaves.
+ *
+ * Several threads may share the tree. Each node a thread passes through counts as a
+ * loss until its playout is counted (a virtual loss), steering the other threads
+ * towards different moves meanwhile.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The most moves any state may have.
+#define MCTS_MAX_MOVES 32
+
+// The largest undo record a game may use.
+#define MCTS_MAX_UNDO_SIZE 64
+
+// The longest playout, counting the moves down the tree. Playouts this long are
+// scored by the utility of the state they reach.
+#define MCTS_MAX_PLAYOUT_PLIES 1024
+
+// How many playouts each thread runs between reads of the clock.
+#define MCTS_TIME_CHECK_INTERVAL 64
+
+/**
+ * A node of the tree, reached from its parent by a move.
+ * Rewards are counted in half points, 2 for a win and 1 for a draw.
+ */
+typedef struct _MCTSNode {
+
+    int move;
+    int player; // The player who made the move, or -1 at the root.
+
+    // Set to 2 once the children are in place, after 1 while a thread is adding them.
+    int expansion;
+
+    int number_children; // 0 where the game is over.
+    struct _MCTSNode *children;
+
+    // Visits include the virtual losses of playouts still under way.
+    long long visits;
+    long long reward;
+
+} MCTSNode;
+
+typedef struct {
+
+    // Search options.
+    // ---------------
+    struct {
+
+        // The budget of the search. Without either, it runs until stop is set.
+        long long max_playouts; // If negative, there is no limit.
+        int time_limit_in_ms; // If negative, there is no limit.
+
+        // The weight of exploring rarely visited moves against exploiting good ones.
+        double exploration;
+
+        // The most nodes the tree may grow to.
+        long long max_nodes;
+
+        // Playouts are counted as this many losses until they finish.
+        int virtual_loss;
+
+        // 1 or less searches on the calling thread only. More threads need copy_state.
+        int threads;
+
+        // Seeds the random moves. A search on a single thread with a playout budget
+        // always makes the same move from the same seed.
+        uint64_t seed;
+
+    } options;
+
+    // Optional flag another thread may set to stop the search as if it ran out of time.
+    int *stop;
+
+    // Game functions, the same as a MinMaxSearch's.
+    int (*utility) (void *state, int for_player);
+    int (*is_terminal) (void *state);
+    int (*get_turn) (void *state);
+    int (*get_moves) (void *state, int *moves);
+    void (*make_move) (void *state, int move, void *undo);
+    void (*unmake_move) (void *state, void *undo);
+    size_t undo_size;
+    void *(*copy_state) (void *state);
+    void (*free_state) (void *state);
+
+    // Optional, plays a state out to the end of the game at random in one call, leaving
+    // the state as it was, and returns its utility for player 0. Playouts otherwise go
+    // move by move through get_moves and make_move.
+    int (*playout) (void *state, uint64_t *random_state);
+
+    // The move found by the last search, and how often it won for the player to play.
+    int best_move;
+    double best_win_rate;
+
+    // Stats.
+    struct {
+        long long playouts;
+        long long nodes;
+        int max_depth; // The deepest node reached in the tree.
+        int threads;
+        long long elapsed_time_ms;
+    } stats;
+
+} MCTSSearch;
+
+/**
+ * Searches the moves from a state, which must not be terminal, within the budget
+ * of the search.
+ *
+ * The state is played on in place and left as it was found.
+ * Returns the most visited move, or -1 if the tree could not be allocated or the
+ * undo record is larger than MCTS_MAX_UNDO_SIZE.
+ */
+int MCTSSearch_search(MCTSSearch *search, void *state);
+
+/**
+ * Prints the stats of the last search.
+ */
+void MCTSSearch_print_stats(MCTSSearch *search);
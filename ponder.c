@@ -0,0 +1,290 @@
+#include "mancala.h"
+#include "gametree.h"
+#include "ponder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static inline long long _Ponder_now_ns() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+
+}
+
+/**
+ * Returns the index of the pondered position matching the board, or -1.
+ */
+static int _Ponder_find(Ponder *ponder, GameBoard *board) {
+
+    for (int i = 0; i < ponder->number_positions; i++) {
+        if (GameBoard_is_same_position(&(ponder->positions[i].board), board)) {
+            return i;
+        }
+    }
+
+    return -1;
+
+}
+
+static void _Ponder_add_position(Ponder *ponder, GameBoard *board) {
+
+    if (ponder->number_positions == PONDER_MAX_POSITIONS || _Ponder_find(ponder, board) >= 0) {
+        return;
+    }
+
+    PonderPosition *position = ponder->positions + ponder->number_positions;
+    memset(position, 0, sizeof(PonderPosition));
+    position->board = *board;
+    ponder->number_positions++;
+
+}
+
+/**
+ * Adds every position the turn of the player to play may end in, following the
+ * predicted line of pits first. A move that plays again continues the same turn.
+ */
+static void _Ponder_add_replies(Ponder *ponder, GameBoard *board, int *predicted, int predicted_length) {
+
+    int first = predicted_length > 0 ? predicted[0] : -1;
+
+    for (int k = -1; k < board->length; k++) {
+
+        int pit = k < 0 ? first : k;
+        if (pit < 0 || (k >= 0 && pit == first) || !GameBoard_is_valid_play(board, pit)) {
+            continue;
+        }
+
+        // Boards hold their lanes inline, so a copy on the stack needs no allocation.
+        GameBoard next = *board;
+        GameBoard_play_turn(&next, pit);
+
+        if (GameBoard_is_game_over(&next)) {
+            continue;
+        }
+
+        if (next.turn == board->turn) {
+            int is_predicted = pit == first;
+            _Ponder_add_replies(ponder, &next, is_predicted ? predicted + 1 : NULL, is_predicted ? predicted_length - 1 : 0);
+        } else {
+            _Ponder_add_position(ponder, &next);
+        }
+
+    }
+
+}
+
+/**
+ * Searches a single position, filling in its result.
+ * Returns 0 if the search was stopped before it finished.
+ */
+static int _Ponder_search(Ponder *ponder, GameBoard *board, PonderResult *result) {
+
+    MinMaxSearch search;
+    ponder->setup_search(&search);
+    search.stop = &(ponder->stop);
+
+    #ifdef ARENA
+        size_t arena_mark_before_search = arena_mark();
+    #endif
+
+    // The search only reads the root, but keeps to a board of its own all the same.
+    GameBoard root_board = *board;
+    Node root;
+    root.game_state = &root_board;
+    root.number_successors = -1;
+
+    long long start_ns = _Ponder_now_ns();
+    Node *to_play = MinMaxSearch_search(&search, &root);
+    result->search_ns = _Ponder_now_ns() - start_ns;
+
+    int is_searched = !search.timed_out;
+    if (is_searched) {
+
+        result->best_move = ((GameBoard *) to_play->game_state)->play_made.pit_played;
+        result->best_utility = search.best_utility;
+        result->nodes_explored = search.stats.nodes_explored;
+
+        // The first move of the principal variation is an index into the root's successors.
+        result->pv_length = search.pv.previous_length;
+        for (int i = 0; i < search.pv.previous_length; i++) {
+            result->pv[i] = search.pv.previous[i];
+        }
+        if (result->pv_length > 0) {
+            result->pv[0] = ((GameBoard *) root.successors[result->pv[0]].game_state)->play_made.pit_played;
+        }
+
+    }
+
+    root.game_state = NULL;
+    Node_cleanup(&root, search.free_state);
+
+    #ifdef ARENA
+        arena_reset_to(arena_mark_before_search);
+    #endif
+
+    return is_searched;
+
+}
+
+/**
+ * The loop of the pondering thread, searching each position in turn.
+ */
+static void *_Ponder_run(void *argument) {
+
+    Ponder *ponder = argument;
+
+    for (int i = 0; i < ponder->number_positions; i++) {
+
+        pthread_mutex_lock(&(ponder->lock));
+        int is_done = ponder->is_last || __atomic_load_n(&(ponder->stop), __ATOMIC_RELAXED);
+        if (!is_done) {
+            ponder->current = i;
+            ponder->current_start_ns = _Ponder_now_ns();
+        }
+        pthread_mutex_unlock(&(ponder->lock));
+
+        if (is_done) {
+            break;
+        }
+
+        PonderResult result;
+        int is_searched = _Ponder_search(ponder, &(ponder->positions[i].board), &result);
+
+        pthread_mutex_lock(&(ponder->lock));
+        ponder->current = -1;
+        ponder->stats.time_pondered_ns += result.search_ns;
+        if (is_searched) {
+            ponder->positions[i].is_searched = 1;
+            ponder->positions[i].result = result;
+            ponder->stats.positions_searched++;
+        }
+        pthread_mutex_unlock(&(ponder->lock));
+
+    }
+
+    return NULL;
+
+}
+
+void Ponder_stop(Ponder *ponder) {
+
+    if (!ponder->is_running) {
+        return;
+    }
+
+    __atomic_store_n(&(ponder->stop), 1, __ATOMIC_RELAXED);
+    pthread_join(ponder->thread, NULL);
+    ponder->is_running = 0;
+
+}
+
+Ponder *Ponder_create(void (*setup_search) (MinMaxSearch *search)) {
+
+    Ponder *ponder = calloc(1, sizeof(Ponder));
+    if (ponder == NULL) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&(ponder->lock), NULL) != 0) {
+        free(ponder);
+        return NULL;
+    }
+
+    ponder->setup_search = setup_search;
+    ponder->current = -1;
+
+    return ponder;
+
+}
+
+void Ponder_delete(Ponder *ponder) {
+
+    Ponder_stop(ponder);
+    pthread_mutex_destroy(&(ponder->lock));
+    free(ponder);
+
+}
+
+int Ponder_start(Ponder *ponder, GameBoard *board, int *predicted, int predicted_length) {
+
+    Ponder_stop(ponder);
+
+    // The positions are fixed before the thread starts, so finding one needs no lock.
+    ponder->number_positions = 0;
+    ponder->current = -1;
+    ponder->is_last = 0;
+    ponder->stop = 0;
+    _Ponder_add_replies(ponder, board, predicted, predicted_length);
+
+    if (ponder->number_positions == 0) {
+        return 1;
+    }
+
+    if (pthread_create(&(ponder->thread), NULL, &_Ponder_run, ponder) != 0) {
+        return 0;
+    }
+    ponder->is_running = 1;
+
+    return 1;
+
+}
+
+int Ponder_finish(Ponder *ponder, GameBoard *board, PonderResult *result) {
+
+    if (!ponder->is_running) {
+        return 0;
+    }
+
+    int index = _Ponder_find(ponder, board);
+
+    pthread_mutex_lock(&(ponder->lock));
+
+    // A position still being searched is left to finish, anything else is stopped.
+    int is_searched = index >= 0 && ponder->positions[index].is_searched;
+    int is_current = index >= 0 && ponder->current == index;
+    long long time_saved_ns = 0;
+    if (is_searched) {
+        time_saved_ns = ponder->positions[index].result.search_ns;
+        __atomic_store_n(&(ponder->stop), 1, __ATOMIC_RELAXED);
+    } else if (is_current) {
+        time_saved_ns = _Ponder_now_ns() - ponder->current_start_ns;
+        ponder->is_last = 1;
+    } else {
+        __atomic_store_n(&(ponder->stop), 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&(ponder->lock));
+
+    pthread_join(ponder->thread, NULL);
+    ponder->is_running = 0;
+
+    // Once the thread is gone, the position being finished has been searched.
+    int is_hit = (is_searched || is_current) && ponder->positions[index].is_searched;
+    if (!is_hit) {
+        ponder->stats.misses++;
+        return 0;
+    }
+
+    ponder->stats.hits++;
+    ponder->stats.time_saved_ns += time_saved_ns;
+    *result = ponder->positions[index].result;
+
+    return 1;
+
+}
+
+void Ponder_print(Ponder *ponder) {
+
+    long long moves = ponder->stats.hits + ponder->stats.misses;
+
+    printf(
+        "Pondering: %lld hits and %lld misses (%.1f%%), %lld positions searched in %lldms on the opponent's time, saving %lldms.\n",
+        ponder->stats.hits, ponder->stats.misses, moves > 0 ? 100.0 * ponder->stats.hits / moves : 0.0,
+        ponder->stats.positions_searched, ponder->stats.time_pondered_ns / 1000000, ponder->stats.time_saved_ns / 1000000
+    );
+
+}
@@ -0,0 +1,123 @@
+/**
+ *
+ * This file describes pondering, searching on the opponent's time.
+ *
+ * Once the engine has played, a thread of its own searches the positions the
+ * opponent's replies may lead to while the opponent is thinking, the reply the
+ * engine expects first. When the engine is to play again, a position that was
+ * already searched is answered at once, and one still being searched is finished
+ * rather than searched again from the start. Any other position stops the thread.
+ *
+ * Every position is searched the same way the engine would search it itself,
+ * sharing its transposition table, so pondering never changes the move played.
+ *
+ */
+
+#include <pthread.h>
+
+// GameBoard and MinMaxSearch come from mancala.h and gametree.h, which must be included first.
+
+// The most positions pondered after a single move.
+#define PONDER_MAX_POSITIONS 32
+
+/**
+ * The result of searching a pondered position.
+ */
+typedef struct {
+
+    int best_move;
+    int best_utility;
+
+    // The principal variation found from the position, in pits.
+    int pv[MINMAXSEARCH_MAX_PV];
+    int pv_length;
+
+    long long search_ns;
+    long long nodes_explored;
+
+} PonderResult;
+
+/**
+ * A position the opponent may leave the engine in.
+ * The board never changes while the thread runs, only the result and whether it is set.
+ */
+typedef struct {
+
+    GameBoard board;
+
+    int is_searched;
+    PonderResult result;
+
+} PonderPosition;
+
+typedef struct {
+
+    // Sets up a search the way the engine searches.
+    void (*setup_search) (MinMaxSearch *search);
+
+    pthread_t thread;
+    int is_running;
+
+    // Set to stop the search under way and every one after it.
+    int stop;
+
+    // Guards everything below.
+    pthread_mutex_t lock;
+
+    PonderPosition positions[PONDER_MAX_POSITIONS];
+    int number_positions;
+
+    // The position being searched, or -1, and when its search started.
+    int current;
+    long long current_start_ns;
+
+    // Set once the position being searched is the one needed, so the thread stops after it.
+    int is_last;
+
+    struct {
+
+        long long hits; // Moves answered from a position searched or being searched.
+        long long misses; // Moves searched afresh after pondering other positions.
+        long long positions_searched; // Positions searched to the end.
+        long long time_pondered_ns; // Time spent searching on the opponent's time.
+        long long time_saved_ns; // The part of it spent on positions then needed.
+
+    } stats;
+
+} Ponder;
+
+/**
+ * Allocates and deallocates a ponder, searching with the given setup.
+ *
+ * Deleting a ponder stops its thread first.
+ * Returns NULL if the ponder could not be allocated.
+ */
+Ponder *Ponder_create(void (*setup_search) (MinMaxSearch *search));
+void Ponder_delete(Ponder *ponder);
+
+/**
+ * Starts pondering a board where the opponent is to play.
+ *
+ * Every position the opponent's turn may end in is searched, following the
+ * predicted line of pits (from the engine's principal variation) first.
+ * Returns 0 if the thread could not be started.
+ */
+int Ponder_start(Ponder *ponder, GameBoard *board, int *predicted, int predicted_length);
+
+/**
+ * Ends pondering once the engine is to play the given board.
+ *
+ * If the board was pondered, waits for its search to finish if need be, fills in
+ * the result and returns 1. Otherwise stops the thread and returns 0.
+ */
+int Ponder_finish(Ponder *ponder, GameBoard *board, PonderResult *result);
+
+/**
+ * Stops pondering, abandoning any search under way.
+ */
+void Ponder_stop(Ponder *ponder);
+
+/**
+ * Prints the statistics of this ponder.
+ */
+void Ponder_print(Ponder *ponder);
@@ -0,0 +1,427 @@
+#include "pool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * The free objects a single thread keeps for a single pool.
+ */
+typedef struct {
+
+    Pool *pool; // NULL while unused.
+    unsigned long long generation; // The pool's, as it was when the cache was made.
+
+    _PoolObject *free_list;
+    int number_free;
+
+    // Added to the pool's statistics when the cache is flushed.
+    long long allocations;
+    long long frees;
+    long long hits;
+    long long misses;
+
+} _PoolCache;
+
+static _Thread_local _PoolCache _pool_caches[POOL_MAX_THREAD_CACHES];
+
+// Flushes the caches of a thread as it exits.
+static pthread_key_t _pool_key;
+static pthread_once_t _pool_key_once = PTHREAD_ONCE_INIT;
+
+// Every pool not yet deleted, and the generation the next pool created takes.
+static pthread_mutex_t _pool_live_lock = PTHREAD_MUTEX_INITIALIZER;
+static Pool *_pool_live = NULL;
+static unsigned long long _pool_next_generation = 1;
+
+/**
+ * Checks if the pool a cache was made for has not been deleted since.
+ * Must be called while holding _pool_live_lock.
+ */
+static int _Pool_is_live(_PoolCache *cache) {
+
+    for (Pool *pool = _pool_live; pool != NULL; pool = pool->next_live) {
+        if (pool == cache->pool && pool->generation == cache->generation) {
+            return 1;
+        }
+    }
+
+    return 0;
+
+}
+
+/**
+ * Returns every cached object and statistic to the pool, leaving the cache empty.
+ */
+static void _Pool_flush_cache(_PoolCache *cache) {
+
+    Pool *pool = cache->pool;
+
+    _PoolObject *tail = cache->free_list;
+    while (tail != NULL && tail->next != NULL) {
+        tail = tail->next;
+    }
+
+    pthread_mutex_lock(&(pool->lock));
+
+    if (tail != NULL) {
+        tail->next = pool->free_list;
+        pool->free_list = cache->free_list;
+    }
+
+    pool->stats.allocations += cache->allocations;
+    pool->stats.frees += cache->frees;
+    pool->stats.hits += cache->hits;
+    pool->stats.misses += cache->misses;
+
+    pthread_mutex_unlock(&(pool->lock));
+
+    cache->free_list = NULL;
+    cache->number_free = 0;
+    cache->allocations = 0;
+    cache->frees = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+
+}
+
+static void _Pool_thread_exit(void *caches) {
+
+    // Pools deleted meanwhile took the objects of their caches with them.
+    pthread_mutex_lock(&_pool_live_lock);
+
+    _PoolCache *thread_caches = caches;
+    for (int i = 0; i < POOL_MAX_THREAD_CACHES; i++) {
+        if (thread_caches[i].pool != NULL && _Pool_is_live(thread_caches + i)) {
+            _Pool_flush_cache(thread_caches + i);
+        }
+        thread_caches[i].pool = NULL;
+    }
+
+    pthread_mutex_unlock(&_pool_live_lock);
+
+}
+
+static void _Pool_create_key() {
+
+    pthread_key_create(&_pool_key, &_Pool_thread_exit);
+
+}
+
+/**
+ * Returns the calling thread's cache for the pool, if it has one.
+ */
+static inline _PoolCache *_Pool_find_cache(Pool *pool) {
+
+    for (int i = 0; i < POOL_MAX_THREAD_CACHES; i++) {
+        if (_pool_caches[i].pool == pool && _pool_caches[i].generation == pool->generation) {
+            return _pool_caches + i;
+        }
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Returns an unused cache of the calling thread, first giving up any left for pools
+ * deleted since, or NULL if every cache is in use.
+ */
+static _PoolCache *_Pool_find_unused_cache() {
+
+    for (int i = 0; i < POOL_MAX_THREAD_CACHES; i++) {
+        if (_pool_caches[i].pool == NULL) {
+            return _pool_caches + i;
+        }
+    }
+
+    _PoolCache *unused = NULL;
+
+    pthread_mutex_lock(&_pool_live_lock);
+    for (int i = 0; i < POOL_MAX_THREAD_CACHES && unused == NULL; i++) {
+        if (!_Pool_is_live(_pool_caches + i)) {
+            unused = _pool_caches + i;
+        }
+    }
+    pthread_mutex_unlock(&_pool_live_lock);
+
+    return unused;
+
+}
+
+/**
+ * Returns the calling thread's cache for the pool, creating it if needed.
+ * Returns NULL if the thread already has as many caches as it may.
+ */
+static inline _PoolCache *_Pool_cache(Pool *pool) {
+
+    _PoolCache *cache = _Pool_find_cache(pool);
+    if (cache != NULL) {
+        return cache;
+    }
+
+    cache = _Pool_find_unused_cache();
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    pthread_once(&_pool_key_once, &_Pool_create_key);
+    pthread_setspecific(_pool_key, _pool_caches);
+
+    memset(cache, 0, sizeof(_PoolCache));
+    cache->pool = pool;
+    cache->generation = pool->generation;
+    return cache;
+
+}
+
+/**
+ * Takes a free object from the pool, or carves a new one from a slab.
+ * The pool must be locked.
+ */
+static void *_Pool_take(Pool *pool) {
+
+    if (pool->free_list != NULL) {
+        _PoolObject *object = pool->free_list;
+        pool->free_list = object->next;
+        return object;
+    }
+
+    if (pool->slab_next == pool->slab_end) {
+
+        void **slabs = realloc(pool->slabs, (pool->number_slabs + 1) * sizeof(void *));
+        if (slabs == NULL) {
+            return NULL;
+        }
+        pool->slabs = slabs;
+
+        char *slab = aligned_alloc(POOL_ALIGNMENT, pool->object_size * pool->objects_per_slab);
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        pool->slabs[pool->number_slabs++] = slab;
+        pool->slab_next = slab;
+        pool->slab_end = slab + pool->object_size * pool->objects_per_slab;
+
+    }
+
+    void *object = pool->slab_next;
+    pool->slab_next += pool->object_size;
+    pool->stats.objects_created++;
+
+    return object;
+
+}
+
+Pool *Pool_create(size_t object_size, int objects_per_slab) {
+
+    Pool *pool = malloc(sizeof(Pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    // Every object must have room for the free list.
+    if (object_size < sizeof(_PoolObject)) {
+        object_size = sizeof(_PoolObject);
+    }
+    pool->object_size = (object_size + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT * POOL_ALIGNMENT;
+    pool->objects_per_slab = objects_per_slab > 0 ? objects_per_slab : 1;
+
+    if (pthread_mutex_init(&(pool->lock), NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->free_list = NULL;
+    pool->slab_next = NULL;
+    pool->slab_end = NULL;
+    pool->slabs = NULL;
+    pool->number_slabs = 0;
+
+    pool->stats.allocations = 0;
+    pool->stats.frees = 0;
+    pool->stats.hits = 0;
+    pool->stats.misses = 0;
+    pool->stats.objects_created = 0;
+
+    pthread_mutex_lock(&_pool_live_lock);
+    pool->generation = _pool_next_generation++;
+    pool->next_live = _pool_live;
+    _pool_live = pool;
+    pthread_mutex_unlock(&_pool_live_lock);
+
+    return pool;
+
+}
+
+void Pool_delete(Pool *pool) {
+
+    // The objects in our own cache are freed with their slabs.
+    _PoolCache *cache = _Pool_find_cache(pool);
+    if (cache != NULL) {
+        cache->pool = NULL;
+        cache->free_list = NULL;
+        cache->number_free = 0;
+    }
+
+    // Once the pool is no longer live, the caches other threads keep for it are not
+    // flushed into it or used again, even if a new pool takes its address.
+    pthread_mutex_lock(&_pool_live_lock);
+    Pool **link = &_pool_live;
+    while (*link != pool) {
+        link = &((*link)->next_live);
+    }
+    *link = pool->next_live;
+    pthread_mutex_unlock(&_pool_live_lock);
+
+    for (int i = 0; i < pool->number_slabs; i++) {
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+
+    pthread_mutex_destroy(&(pool->lock));
+    free(pool);
+
+}
+
+void *Pool_allocate(Pool *pool) {
+
+    _PoolCache *cache = _Pool_cache(pool);
+
+    // Without a cache, every allocation goes to the pool.
+    if (cache == NULL) {
+
+        pthread_mutex_lock(&(pool->lock));
+        void *object = _Pool_take(pool);
+        pool->stats.allocations++;
+        pool->stats.misses++;
+        pthread_mutex_unlock(&(pool->lock));
+
+        return object;
+
+    }
+
+    cache->allocations++;
+
+    // Refill an empty cache with a whole batch at once.
+    if (cache->free_list == NULL) {
+
+        cache->misses++;
+
+        pthread_mutex_lock(&(pool->lock));
+        for (int i = 0; i < POOL_BATCH_SIZE; i++) {
+
+            _PoolObject *object = _Pool_take(pool);
+            if (object == NULL) {
+                break;
+            }
+
+            object->next = cache->free_list;
+            cache->free_list = object;
+            cache->number_free++;
+
+        }
+        pthread_mutex_unlock(&(pool->lock));
+
+        if (cache->free_list == NULL) {
+            return NULL;
+        }
+
+    } else {
+        cache->hits++;
+    }
+
+    _PoolObject *object = cache->free_list;
+    cache->free_list = object->next;
+    cache->number_free--;
+
+    return object;
+
+}
+
+void Pool_free(Pool *pool, void *object) {
+
+    if (object == NULL) {
+        return;
+    }
+
+    _PoolObject *freed = object;
+    _PoolCache *cache = _Pool_cache(pool);
+
+    if (cache == NULL) {
+
+        pthread_mutex_lock(&(pool->lock));
+        freed->next = pool->free_list;
+        pool->free_list = freed;
+        pool->stats.frees++;
+        pthread_mutex_unlock(&(pool->lock));
+
+        return;
+
+    }
+
+    freed->next = cache->free_list;
+    cache->free_list = freed;
+    cache->number_free++;
+    cache->frees++;
+
+    // Return a batch once the cache holds two, so a thread that only frees
+    // does not keep every object to itself.
+    if (cache->number_free >= 2 * POOL_BATCH_SIZE) {
+
+        _PoolObject *first = cache->free_list;
+        _PoolObject *last = first;
+        for (int i = 1; i < POOL_BATCH_SIZE; i++) {
+            last = last->next;
+        }
+
+        cache->free_list = last->next;
+        cache->number_free -= POOL_BATCH_SIZE;
+
+        pthread_mutex_lock(&(pool->lock));
+        last->next = pool->free_list;
+        pool->free_list = first;
+        pthread_mutex_unlock(&(pool->lock));
+
+    }
+
+}
+
+void Pool_flush(Pool *pool) {
+
+    _PoolCache *cache = _Pool_find_cache(pool);
+    if (cache != NULL) {
+        _Pool_flush_cache(cache);
+    }
+
+}
+
+void Pool_print(Pool *pool) {
+
+    pthread_mutex_lock(&(pool->lock));
+
+    long long allocations = pool->stats.allocations;
+    long long frees = pool->stats.frees;
+    long long hits = pool->stats.hits;
+    long long misses = pool->stats.misses;
+    long long objects_created = pool->stats.objects_created;
+    int number_slabs = pool->number_slabs;
+
+    pthread_mutex_unlock(&(pool->lock));
+
+    // Include our own cache, which has not been flushed.
+    _PoolCache *cache = _Pool_find_cache(pool);
+    if (cache != NULL) {
+        allocations += cache->allocations;
+        frees += cache->frees;
+        hits += cache->hits;
+        misses += cache->misses;
+    }
+
+    printf(
+        "Pool: %lld objects of %zu bytes created in %d slabs, %lld allocations and %lld frees, with %lld cache hits and %lld misses (%.1f%%).\n",
+        objects_created, pool->object_size, number_slabs, allocations, frees, hits, misses,
+        allocations > 0 ? 100.0 * hits / allocations : 0.0
+    );
+
+}
@@ -0,0 +1,116 @@
+/**
+ *
+ * This file describes a pool of fixed-size objects.
+ *
+ * Like an arena, a pool holds only one size of object, carved
+ * from large slabs of memory. Unlike an arena, objects can be
+ * freed one at a time and are reused by later allocations, so
+ * a pool stays the size of the most objects live at once.
+ *
+ * Freed objects are kept on an intrusive free list, linked
+ * through the objects themselves, so allocating and freeing
+ * take constant time.
+ *
+ * The pool is shared by every thread, but each thread keeps
+ * a small cache of free objects of its own and only takes the
+ * pool's lock to move objects to or from the cache in batches.
+ * A thread's caches are returned to their pools when it exits.
+ *
+ * Every object starts on its own cache line.
+ *
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+
+// The alignment and size granularity of every object.
+#define POOL_ALIGNMENT 64
+
+// The number of objects moved between a thread cache and its pool at once.
+// A cache holding twice this many returns a batch.
+#define POOL_BATCH_SIZE 32
+
+// The most pools a single thread keeps caches for. Other pools are used directly.
+#define POOL_MAX_THREAD_CACHES 4
+
+// An object on a free list.
+typedef struct _PoolObject {
+
+    struct _PoolObject *next;
+
+} _PoolObject;
+
+typedef struct _Pool {
+
+    // The size of individual objects, rounded up to the alignment.
+    size_t object_size;
+    int objects_per_slab;
+
+    // Guards everything below.
+    pthread_mutex_t lock;
+
+    // Objects freed back to the pool.
+    _PoolObject *free_list;
+
+    // The unused end of the newest slab.
+    char *slab_next;
+    char *slab_end;
+
+    // Every slab, to be freed with the pool.
+    void **slabs;
+    int number_slabs;
+
+    // Tells this pool apart from any deleted one at the same address, so that caches
+    // left for a deleted pool are never used again.
+    unsigned long long generation;
+    struct _Pool *next_live;
+
+    struct {
+
+        long long allocations;
+        long long frees;
+
+        // Allocations served by a thread cache without taking the lock,
+        // and those that had to go to the pool.
+        long long hits;
+        long long misses;
+
+        // Objects carved from slabs, never previously used.
+        long long objects_created;
+
+    } stats;
+
+} Pool;
+
+/**
+ * Allocates and deallocates a pool.
+ *
+ * A pool must only be deleted once no other thread is using it. Objects left in
+ * the caches of other threads are freed with the pool, and those caches are never
+ * used again. Returns NULL if the pool could not be allocated.
+ */
+Pool *Pool_create(size_t object_size, int objects_per_slab);
+void Pool_delete(Pool *pool);
+
+/**
+ * Allocates a single object, or returns NULL if the pool could not grow.
+ */
+void *Pool_allocate(Pool *pool);
+
+/**
+ * Frees a single object to the calling thread's cache.
+ * The object may be freed by a different thread from the one that allocated it.
+ */
+void Pool_free(Pool *pool, void *object);
+
+/**
+ * Returns every object in the calling thread's cache to the pool.
+ */
+void Pool_flush(Pool *pool);
+
+/**
+ * Prints the statistics of this pool.
+ * Caches of other threads are counted once they have been flushed.
+ */
+void Pool_print(Pool *pool);
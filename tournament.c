@@ -0,0 +1,313 @@
+#include "mancala.h"
+#include "tournament.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The outcome of a single game.
+ */
+typedef struct {
+
+    int player_indices[2]; // Into the tournament's players, by side.
+    int game; // Within its pairing.
+
+    int winner; // 0 or 1, or -1 for a draw.
+    int forfeit; // The side that made an invalid play, or -1.
+    int scores[2];
+    int moves[2];
+    long long nodes[2];
+    long long time_us[2];
+
+} _TournamentGame;
+
+/**
+ * The shared state of a tournament being played across several threads.
+ */
+typedef struct {
+
+    TournamentPlayer *players;
+    TournamentOptions *options;
+
+    _TournamentGame *games;
+    int number_games;
+
+    // The next game to play, taken by each thread in turn.
+    int next_game;
+
+} _Tournament;
+
+static inline long long _now_us() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+
+}
+
+/**
+ * Returns the next number from a splitmix64 sequence.
+ */
+static inline uint64_t _Tournament_random(uint64_t *state) {
+
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+
+}
+
+/**
+ * Plays a single game to the end and fills in its outcome.
+ */
+static void _Tournament_play(_Tournament *tournament, _TournamentGame *game) {
+
+    TournamentOptions *options = tournament->options;
+
+    game->winner = -1;
+    game->forfeit = -1;
+    for (int side = 0; side < 2; side++) {
+        game->scores[side] = 0;
+        game->moves[side] = 0;
+        game->nodes[side] = 0;
+        game->time_us[side] = 0;
+    }
+
+    #ifdef ARENA
+        // Each thread plays from its own arena, released at the end of every game.
+        size_t arena_mark_before_game = arena_mark();
+    #endif
+
+    GameBoard *board = GameBoard_create(options->length, options->starting_seeds);
+    if (board == NULL) {
+        return;
+    }
+
+    // Both games of a pair start from the same opening.
+    uint64_t random_state = options->seed ^ (0x9e3779b97f4a7c15ULL * (uint64_t) (game->game / 2 + 1));
+    for (int ply = 0; ply < options->opening_plies && !GameBoard_is_game_over(board); ply++) {
+
+        int moves[GAMEBOARD_MAX_LENGTH];
+        int number_moves = GameBoard_get_moves(board, moves);
+        GameBoard_play_turn(board, moves[_Tournament_random(&random_state) % number_moves]);
+
+    }
+
+    while (!GameBoard_is_game_over(board)) {
+
+        int side = board->turn;
+        TournamentPlayer *player = tournament->players + game->player_indices[side];
+
+        long long start_us = _now_us();
+        int pit_to_play = player->play(board);
+        game->time_us[side] += _now_us() - start_us;
+
+        game->moves[side]++;
+        if (player->nodes_explored) {
+            game->nodes[side] += player->nodes_explored();
+        }
+
+        if (!GameBoard_is_valid_play(board, pit_to_play)) {
+            game->forfeit = side;
+            break;
+        }
+
+        GameBoard_play_turn(board, pit_to_play);
+
+    }
+
+    game->scores[0] = GameBoard_score_of(board, 0);
+    game->scores[1] = GameBoard_score_of(board, 1);
+    if (game->forfeit >= 0) {
+        game->winner = (game->forfeit + 1) % 2;
+    } else {
+        game->winner = GameBoard_winner_is(board);
+    }
+
+    GameBoard_delete(board);
+
+    #ifdef ARENA
+        arena_reset_to(arena_mark_before_game);
+    #endif
+
+}
+
+static void *_Tournament_run_worker(void *argument) {
+
+    _Tournament *tournament = argument;
+
+    while (1) {
+
+        int i = __atomic_fetch_add(&(tournament->next_game), 1, __ATOMIC_RELAXED);
+        if (i >= tournament->number_games) {
+            break;
+        }
+
+        _Tournament_play(tournament, tournament->games + i);
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Writes a row for every game.
+ */
+static int _Tournament_write_games(_Tournament *tournament, const char *path) {
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    TournamentOptions *options = tournament->options;
+
+    fprintf(file, "game,player_0,player_1,length,starting_seeds,opening_plies,winner,forfeit,score_0,score_1,moves_0,moves_1,nodes_0,nodes_1,time_us_0,time_us_1\n");
+    for (int i = 0; i < tournament->number_games; i++) {
+
+        _TournamentGame *game = tournament->games + i;
+        fprintf(
+            file, "%d,%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%lld,%lld,%lld,%lld\n",
+            i,
+            tournament->players[game->player_indices[0]].name,
+            tournament->players[game->player_indices[1]].name,
+            options->length, options->starting_seeds, options->opening_plies,
+            game->winner, game->forfeit,
+            game->scores[0], game->scores[1],
+            game->moves[0], game->moves[1],
+            game->nodes[0], game->nodes[1],
+            game->time_us[0], game->time_us[1]
+        );
+
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+
+}
+
+/**
+ * Writes a row for every player against every opponent it met.
+ * A game between a player and itself counts once for each side.
+ */
+static int _Tournament_write_summary(_Tournament *tournament, int number_players, const char *path) {
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fprintf(file, "player,opponent,games,wins,draws,losses,forfeits,moves,nodes,time_us,time_per_move_us,nodes_per_second\n");
+    for (int player = 0; player < number_players; player++) {
+        for (int opponent = 0; opponent < number_players; opponent++) {
+
+            int games = 0, wins = 0, draws = 0, losses = 0, forfeits = 0, moves = 0;
+            long long nodes = 0, time_us = 0;
+
+            for (int i = 0; i < tournament->number_games; i++) {
+
+                _TournamentGame *game = tournament->games + i;
+                for (int side = 0; side < 2; side++) {
+
+                    int other_side = (side + 1) % 2;
+                    if (game->player_indices[side] != player || game->player_indices[other_side] != opponent) {
+                        continue;
+                    }
+
+                    games++;
+                    wins += game->winner == side;
+                    draws += game->winner == -1;
+                    losses += game->winner == other_side;
+                    forfeits += game->forfeit == side;
+                    moves += game->moves[side];
+                    nodes += game->nodes[side];
+                    time_us += game->time_us[side];
+
+                }
+
+            }
+
+            if (games == 0) {
+                continue;
+            }
+
+            fprintf(
+                file, "%s,%s,%d,%d,%d,%d,%d,%d,%lld,%lld,%.1f,%.0f\n",
+                tournament->players[player].name, tournament->players[opponent].name,
+                games, wins, draws, losses, forfeits, moves, nodes, time_us,
+                moves > 0 ? (double) time_us / moves : 0.0,
+                time_us > 0 ? nodes * 1e6 / time_us : 0.0
+            );
+
+        }
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+
+}
+
+int Tournament_run(TournamentPlayer *players, int number_players, TournamentOptions *options) {
+
+    _Tournament tournament;
+    tournament.players = players;
+    tournament.options = options;
+    tournament.next_game = 0;
+
+    // Every player meets every other and itself, games_per_pairing times.
+    int number_pairings = number_players * (number_players + 1) / 2;
+    tournament.number_games = number_pairings * options->games_per_pairing;
+    tournament.games = malloc(tournament.number_games * sizeof(_TournamentGame));
+    if (tournament.games == NULL) {
+        return -1;
+    }
+
+    int i = 0;
+    for (int a = 0; a < number_players; a++) {
+        for (int b = a; b < number_players; b++) {
+            for (int game = 0; game < options->games_per_pairing; game++) {
+
+                // Swap sides every game.
+                tournament.games[i].player_indices[game % 2] = a;
+                tournament.games[i].player_indices[(game + 1) % 2] = b;
+                tournament.games[i].game = game;
+                i++;
+
+            }
+        }
+    }
+
+    int number_threads = options->threads > 1 ? options->threads : 1;
+    pthread_t *threads = malloc(number_threads * sizeof(pthread_t));
+    if (threads == NULL) {
+        free(tournament.games);
+        return -1;
+    }
+
+    // The calling thread plays games as well.
+    int number_started = 0;
+    while (number_started < number_threads - 1 && pthread_create(threads + number_started, NULL, &_Tournament_run_worker, &tournament) == 0) {
+        number_started++;
+    }
+    _Tournament_run_worker(&tournament);
+
+    for (int j = 0; j < number_started; j++) {
+        pthread_join(threads[j], NULL);
+    }
+    free(threads);
+
+    int result = 0;
+    if (options->games_path && _Tournament_write_games(&tournament, options->games_path) != 0) {
+        result = -1;
+    }
+    if (options->summary_path && _Tournament_write_summary(&tournament, number_players, options->summary_path) != 0) {
+        result = -1;
+    }
+
+    free(tournament.games);
+
+    return result;
+
+}
@@ -0,0 +1,57 @@
+/**
+ *
+ * This file describes a headless tournament between players of Mancala.
+ *
+ * Every pair of players, each player against itself included, plays a number of
+ * games with no console output. Games are played in pairs from the same opening,
+ * a few random plays into the game, with the players swapping sides between them.
+ * Games are shared between threads, one game per thread at a time.
+ *
+ * Every game is written as a row of one CSV file, and the totals of each player
+ * against each opponent as a row of another.
+ *
+ */
+
+#include <stdint.h>
+
+// GameBoard comes from mancala.h, which must be included first.
+
+typedef struct {
+
+    const char *name;
+
+    // Returns the pit to play. A pit that is not a valid play forfeits the game.
+    int (*play) (GameBoard *board);
+
+    // Optional, returns the nodes explored by the last play made on the calling thread.
+    long long (*nodes_explored) ();
+
+} TournamentPlayer;
+
+typedef struct {
+
+    int games_per_pairing;
+    int length;
+    int starting_seeds;
+
+    // The number of random plays made before the players take over.
+    int opening_plies;
+
+    // Seeds the random openings, so a tournament can be played again exactly.
+    uint64_t seed;
+
+    int threads; // 1 or less plays every game on the calling thread.
+
+    // Where to write the CSV files, either may be NULL.
+    const char *games_path;
+    const char *summary_path;
+
+} TournamentOptions;
+
+/**
+ * Plays every pairing of the given players and writes the results.
+ *
+ * Returns 0 on success or -1 if memory could not be allocated or a file could not
+ * be written.
+ */
+int Tournament_run(TournamentPlayer *players, int number_players, TournamentOptions *options);
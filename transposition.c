@@ -0,0 +1,83 @@
+#include "transposition.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(TranspositionEntry) == sizeof(uint64_t), "An entry must pack into a single word.");
+
+TranspositionTable *TranspositionTable_create(size_t size_in_bytes) {
+
+    TranspositionTable *table = malloc(sizeof(TranspositionTable));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    // Use the largest power of two number of slots that fits.
+    table->number_slots = 1;
+    while (table->number_slots * 2 * sizeof(_TranspositionSlot) <= size_in_bytes) {
+        table->number_slots *= 2;
+    }
+
+    table->slots = malloc(table->number_slots * sizeof(_TranspositionSlot));
+    if (table->slots == NULL) {
+        free(table);
+        return NULL;
+    }
+
+    TranspositionTable_clear(table);
+
+    return table;
+
+}
+
+void TranspositionTable_delete(TranspositionTable *table) {
+
+    free(table->slots);
+    free(table);
+
+}
+
+void TranspositionTable_clear(TranspositionTable *table) {
+
+    // An empty slot has no data, which no stored entry can have as its depth is at least 1.
+    memset(table->slots, 0, table->number_slots * sizeof(_TranspositionSlot));
+
+}
+
+int TranspositionTable_probe(TranspositionTable *table, uint64_t key, TranspositionEntry *entry) {
+
+    _TranspositionSlot *slot = table->slots + (key & (table->number_slots - 1));
+
+    uint64_t check = __atomic_load_n(&(slot->check), __ATOMIC_RELAXED);
+    uint64_t data = __atomic_load_n(&(slot->data), __ATOMIC_RELAXED);
+
+    if (data == 0) {
+        return TRANSPOSITION_MISS;
+    }
+
+    if ((check ^ data) != key) {
+        return TRANSPOSITION_COLLISION;
+    }
+
+    memcpy(entry, &data, sizeof(TranspositionEntry));
+    return TRANSPOSITION_HIT;
+
+}
+
+void TranspositionTable_store(TranspositionTable *table, uint64_t key, int depth, int utility, int bound, int best_move) {
+
+    _TranspositionSlot *slot = table->slots + (key & (table->number_slots - 1));
+
+    TranspositionEntry entry;
+    entry.utility = utility;
+    entry.depth = depth;
+    entry.bound = bound;
+    entry.best_move = best_move;
+
+    uint64_t data;
+    memcpy(&data, &entry, sizeof(uint64_t));
+
+    __atomic_store_n(&(slot->check), key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&(slot->data), data, __ATOMIC_RELAXED);
+
+}
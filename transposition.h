@@ -0,0 +1,81 @@
+/**
+ *
+ * This file describes a fixed-size transposition table.
+ *
+ * The table maps the hash of a game state to what a search has learnt about it:
+ * the depth it was searched to, the utility found, whether that utility is exact
+ * or only a bound, and the best move.
+ *
+ * The table is a power-of-two number of slots, each holding a single entry.
+ * A store always replaces whatever was in its slot.
+ *
+ * The table may be shared between threads without locks. Each slot keeps its key
+ * XORed with its entry, so a slot torn by two threads writing at once simply no
+ * longer matches either key and reads as a collision.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The kinds of utility an entry may hold.
+#define TRANSPOSITION_EXACT 0 // The utility is the true utility at this depth.
+#define TRANSPOSITION_LOWER 1 // The true utility is at least this (a cutoff above beta).
+#define TRANSPOSITION_UPPER 2 // The true utility is at most this (nothing beat alpha).
+
+// The results of probing the table.
+#define TRANSPOSITION_MISS 0 // The slot is empty.
+#define TRANSPOSITION_HIT 1 // The slot holds an entry for the key.
+#define TRANSPOSITION_COLLISION 2 // The slot holds an entry for another key.
+
+typedef struct {
+
+    int32_t utility;
+    int16_t depth; // Always at least 1, only interior nodes are stored.
+    int8_t bound;
+    int8_t best_move;
+
+} TranspositionEntry;
+
+typedef struct {
+
+    // The key XORed with the entry's bits, and the entry's bits.
+    uint64_t check;
+    uint64_t data;
+
+} _TranspositionSlot;
+
+typedef struct {
+
+    _TranspositionSlot *slots;
+
+    // The number of slots, always a power of two.
+    size_t number_slots;
+
+} TranspositionTable;
+
+/**
+ * Allocates and deallocates a table using at most size_in_bytes of memory for slots.
+ *
+ * Returns NULL if the table could not be allocated.
+ */
+TranspositionTable *TranspositionTable_create(size_t size_in_bytes);
+void TranspositionTable_delete(TranspositionTable *table);
+
+/**
+ * Forgets every entry in the table.
+ */
+void TranspositionTable_clear(TranspositionTable *table);
+
+/**
+ * Looks up the entry for the given key.
+ * On a hit the entry is copied out, otherwise it is left untouched.
+ *
+ * Returns one of TRANSPOSITION_MISS, TRANSPOSITION_HIT or TRANSPOSITION_COLLISION.
+ */
+int TranspositionTable_probe(TranspositionTable *table, uint64_t key, TranspositionEntry *entry);
+
+/**
+ * Stores an entry for the given key, replacing what was in its slot.
+ */
+void TranspositionTable_store(TranspositionTable *table, uint64_t key, int depth, int utility, int bound, int best_move);